@@ -163,24 +163,85 @@ uint32_t hash_bytes(uint8_t *__restrict buffer, int length)
 }
 
 // Random
+static inline uint64_t rotl_64(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+static uint64_t splitmix_64(uint64_t *x)
+{
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27))*0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t xoshiro_next(uint64_t *s)
+{
+    uint64_t result = rotl_64(s[1]*5, 7)*9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl_64(s[3], 45);
+    return result;
+}
+
+static void xoshiro_jump(RandomEngine *engine, const uint64_t *polynomial)
+{
+    uint64_t s[4] = {0, 0, 0, 0};
+    for (int i=0; i<4; ++i)
+    {
+        for (int b=0; b<64; ++b)
+        {
+            if (polynomial[i] & (uint64_t(1) << b))
+            {
+                s[0] ^= engine->state[0];
+                s[1] ^= engine->state[1];
+                s[2] ^= engine->state[2];
+                s[3] ^= engine->state[3];
+            }
+            xoshiro_next(engine->state);
+        }
+    }
+    memcpy(engine->state, s, sizeof(s));
+}
+
 void init_random_engine(RandomEngine *engine, bool verbose)
 {
-    // Simple LCG random number generator
-    engine->seed = (uint32_t) SDL_GetPerformanceCounter();
+    // Seeded from the clock, use set_rand_seed for reproducible runs
+    engine->seed = (uint64_t) SDL_GetPerformanceCounter();
     engine->verbose = verbose;
-    engine->modulus = INT_MAX;
-    engine->multiplier = 1103515245;
-    engine->increment = 12345;
     reset_random_engine(engine);
 }
 
+void init_random_stream(RandomEngine *stream, RandomEngine *parent, int32_t streamIndex)
+{
+    // Independent stream for e.g. one worker thread: the parent sequence
+    // advanced by (streamIndex + 1)*2^128 steps, so it only depends on the seed
+    SDL_assert(streamIndex >= 0);
+    stream->seed = parent->seed;
+    stream->verbose = parent->verbose;
+    reset_random_engine(stream);
+    for (int32_t i=0; i<=streamIndex; ++i)
+    {
+        rand_jump(stream);
+    }
+}
+
 void reset_random_engine(RandomEngine *engine)
 {
     engine->nInvocations = 0;
-    engine->state = engine->seed;
+    uint64_t x = engine->seed;
+    for (int i=0; i<4; ++i)
+    {
+        engine->state[i] = splitmix_64(&x);
+    }
     if (engine->verbose)
     {
-        printf("Reset random engine, seed %u\n", engine->seed);
+        printf("Reset random engine, seed %" PRIu64 "\n", engine->seed);
     }
 }
 
@@ -190,43 +251,69 @@ void delete_random_engine(RandomEngine *engine)
     engine->seed = -1;
 }
 
-void set_rand_seed(RandomEngine *engine, uint32_t seed)
+void set_rand_seed(RandomEngine *engine, uint64_t seed)
 {
     engine->seed = seed;
     reset_random_engine(engine);
     if (engine->verbose)
     {
-        printf("Set random seed to %u\n", seed);
+        printf("Set random seed to %" PRIu64 "\n", seed);
     }
 }
 
-int rand_evolve(RandomEngine *engine)
+void rand_jump(RandomEngine *engine)
+{
+    // Equivalent to 2^128 calls to rand_evolve
+    static const uint64_t polynomial[4] = {0x180ec6d33cfd0abaull, 0xd5a61266f0c9392cull, 0xa9582618e03fc9aaull, 0x39abdc4529b1661cull};
+    xoshiro_jump(engine, polynomial);
+}
+
+void rand_long_jump(RandomEngine *engine)
+{
+    // Equivalent to 2^192 calls to rand_evolve
+    static const uint64_t polynomial[4] = {0x76e15d3efefdcbbfull, 0xc5004e441c522fb3ull, 0x77710069854ee241ull, 0x39109bb02acbe635ull};
+    xoshiro_jump(engine, polynomial);
+}
+
+uint64_t rand_evolve(RandomEngine *engine)
 {
     engine->nInvocations += 1;
-    engine->state = (engine->multiplier*engine->state + engine->increment) % engine->modulus;
-    return int((engine->state/65536) % 32768);
+    return xoshiro_next(engine->state);
 }
 
-int rand_max()
+uint32_t rand_u32(RandomEngine *engine)
 {
-    return SHRT_MAX;
+    // Upper bits are the strongest
+    return (uint32_t) (rand_evolve(engine) >> 32);
+}
+
+uint64_t rand_u64(RandomEngine *engine)
+{
+    return rand_evolve(engine);
 }
 
 int weighted_rand_i(RandomEngine *engine, DynamicArray<float> *weights, int minV)
 {
+    // O(n) per draw, use an AliasTable (alias_table.h) to draw repeatedly
     float sum = 0;
     for (int i=0; i<weights->size; ++i)
     {
         sum += weights->data[i];
     }
 
+    if (sum <= 0)
+    {
+        // Nothing to choose by, same as the first index
+        return minV;
+    }
+
     float rand = rand_f(engine, 0, sum);
 
     sum = 0;
     for (int i=0; i<weights->size; ++i)
     {
         sum += weights->data[i];
-        if (sum >= rand)
+        if (rand < sum)
         {
             return minV + i;
         }
@@ -237,13 +324,15 @@ int weighted_rand_i(RandomEngine *engine, DynamicArray<float> *weights, int minV
 
 int rand_i(RandomEngine *engine, int minV, int maxV)
 {
+    // Uniform in [minV, maxV), multiply-shift instead of modulo
+    // The range is taken in 64 bits, maxV - minV overflows int for wide ranges
     SDL_assert(maxV > minV);
-    SDL_assert(maxV - minV < rand_max());
-    int result = rand_evolve(engine) % (maxV - minV) + minV;
+    uint32_t range = (uint32_t) (int64_t(maxV) - int64_t(minV));
+    int result = (int) (int64_t(minV) + int64_t((uint64_t(rand_u32(engine))*range) >> 32));
 
     if (engine->verbose && engine->nInvocations < 10)
     {
-        printf("Rand %d Integer %d %d: %d\n", engine->nInvocations, minV, maxV, result);
+        printf("Rand %" PRId64 " Integer %d %d: %d\n", engine->nInvocations, minV, maxV, result);
     }
 
     return result;
@@ -251,16 +340,63 @@ int rand_i(RandomEngine *engine, int minV, int maxV)
 
 float rand_f(RandomEngine *engine, float minV, float maxV)
 {
-    float result = (float) rand_evolve(engine) / ((float) rand_max() / (maxV - minV)) + minV;
+    // Uniform in [minV, maxV), 24 random bits fill the float mantissa
+    float unit = float(rand_evolve(engine) >> 40)*(1.0f/16777216.0f);
+    float result = minV + unit*(maxV - minV);
+    // Rounding can land on maxV for the largest draws. Reversed ranges
+    // (maxV < minV) are left as they are.
+    if (maxV > minV)
+    {
+        result = fminf(result, nextafterf(maxV, minV));
+    }
 
     if (engine->verbose && engine->nInvocations < 10)
     {
-        printf("Rand %d Float %f %f: %f\n", engine->nInvocations, minV, maxV, result);
+        printf("Rand %" PRId64 " Float %f %f: %f\n", engine->nInvocations, minV, maxV, result);
     }
 
     return result;
 }
 
+// Bulk versions keep the state in registers for the whole loop
+void rand_fill_u32(RandomEngine *engine, uint32_t *values, int32_t n)
+{
+    uint64_t s[4];
+    memcpy(s, engine->state, sizeof(s));
+    for (int32_t i=0; i<n; ++i)
+    {
+        values[i] = (uint32_t) (xoshiro_next(s) >> 32);
+    }
+    memcpy(engine->state, s, sizeof(s));
+    engine->nInvocations += n;
+}
+
+void rand_fill_u64(RandomEngine *engine, uint64_t *values, int32_t n)
+{
+    uint64_t s[4];
+    memcpy(s, engine->state, sizeof(s));
+    for (int32_t i=0; i<n; ++i)
+    {
+        values[i] = xoshiro_next(s);
+    }
+    memcpy(engine->state, s, sizeof(s));
+    engine->nInvocations += n;
+}
+
+void rand_fill_f(RandomEngine *engine, float *values, int32_t n, float minV, float maxV)
+{
+    uint64_t s[4];
+    memcpy(s, engine->state, sizeof(s));
+    float scale = (maxV - minV)*(1.0f/16777216.0f);
+    float highest = maxV > minV ? nextafterf(maxV, minV) : INFINITY;
+    for (int32_t i=0; i<n; ++i)
+    {
+        values[i] = fminf(minV + float(xoshiro_next(s) >> 40)*scale, highest);
+    }
+    memcpy(engine->state, s, sizeof(s));
+    engine->nInvocations += n;
+}
+
 // Lerp
 float lerp_f(float a, float b, float f)
 {
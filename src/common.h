@@ -63,24 +63,29 @@ const T& max_i(const T& a, const T& b)
 // Random generator
 struct RandomEngine
 {
-    uint32_t seed;
-    uint32_t state;
-    uint32_t modulus;
-    uint32_t multiplier;
-    uint32_t increment;
-    int nInvocations;
+    // xoshiro256**, seeded through splitmix64
+    uint64_t seed;
+    uint64_t state[4];
+    int64_t nInvocations;
     bool verbose;
 };
 
 void init_random_engine(RandomEngine *engine, bool verbose);
+void init_random_stream(RandomEngine *stream, RandomEngine *parent, int32_t streamIndex);
 void reset_random_engine(RandomEngine *engine);
 void delete_random_engine(RandomEngine *engine);
-void set_rand_seed(RandomEngine *engine, uint32_t seed);
-int rand_max();
-int rand_evolve(RandomEngine *engine);
+void set_rand_seed(RandomEngine *engine, uint64_t seed);
+void rand_jump(RandomEngine *engine);
+void rand_long_jump(RandomEngine *engine);
+uint64_t rand_evolve(RandomEngine *engine);
+uint32_t rand_u32(RandomEngine *engine);
+uint64_t rand_u64(RandomEngine *engine);
 int rand_i(RandomEngine *engine, int minV, int maxV);
 int weighted_rand_i(RandomEngine *engine, DynamicArray<float> *weights, int minV);
 float rand_f(RandomEngine *engine, float minV, float maxV);
+void rand_fill_u32(RandomEngine *engine, uint32_t *values, int32_t n);
+void rand_fill_u64(RandomEngine *engine, uint64_t *values, int32_t n);
+void rand_fill_f(RandomEngine *engine, float *values, int32_t n, float minV, float maxV);
 
 // Lerp
 float lerp_f(float a, float b, float f);
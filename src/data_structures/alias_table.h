@@ -0,0 +1,182 @@
+#ifndef ALIAS_TABLE_H
+#define ALIAS_TABLE_H
+
+#include "stdlib.h"
+#include "stdio.h"
+
+#include "SDL_assert.h"
+
+#include "dynamic_array.h"
+#include "../common.h"
+
+// Alias table (Vose) for repeated sampling from one discrete distribution.
+// Building is O(n). Without slack every draw is O(1) with a single call to
+// the random engine.
+//
+// With slack > 0 the table is built from weights raised by that fraction and
+// draws are corrected by rejection, so set_alias_weight() can change weights
+// in place. Each attempt then takes a second call for the rejection test and
+// a draw takes at most 2*(1 + slack) attempts on average. The table only rebuilds once a weight outgrows its bound or the
+// acceptance rate has halved since the last build.
+struct AliasTable
+{
+    float slack;
+    float totalWeight;
+    float totalBound;
+    bool needsRebuild;
+    DynamicArray<float> weights;
+    DynamicArray<float> bounds;
+    DynamicArray<float> probabilities;
+    DynamicArray<int32_t> aliases;
+    DynamicArray<int32_t> worklist;
+};
+
+static void rebuild_alias_table(AliasTable *table)
+{
+    int32_t n = table->weights.size;
+    SDL_assert(n > 0);
+
+    table->totalWeight = 0;
+    table->totalBound = 0;
+    for (int32_t i=0; i<n; ++i)
+    {
+        SDL_assert(table->weights.data[i] >= 0);
+        table->bounds.data[i] = (1.0f + table->slack)*table->weights.data[i];
+        table->totalWeight += table->weights.data[i];
+        table->totalBound += table->bounds.data[i];
+    }
+    table->needsRebuild = false;
+
+    if (table->totalBound <= 0)
+    {
+        // All weights zero, alias_rand_i() returns minV until one is set
+        for (int32_t i=0; i<n; ++i)
+        {
+            table->probabilities.data[i] = 1.0f;
+            table->aliases.data[i] = i;
+        }
+        return;
+    }
+
+    // Scale to mean 1, small entries stack up from the front of the worklist,
+    // large ones from the back
+    float *p = table->probabilities.data;
+    int32_t *alias = table->aliases.data;
+    int32_t *work = table->worklist.data;
+    int32_t nSmall = 0;
+    int32_t nLarge = 0;
+    float scale = float(n)/table->totalBound;
+
+    for (int32_t i=0; i<n; ++i)
+    {
+        p[i] = scale*table->bounds.data[i];
+        alias[i] = i;
+        if (p[i] < 1.0f)
+        {
+            work[nSmall++] = i;
+        }
+        else
+        {
+            work[n - 1 - nLarge++] = i;
+        }
+    }
+
+    while (nSmall > 0 && nLarge > 0)
+    {
+        int32_t s = work[--nSmall];
+        int32_t l = work[n - nLarge];
+        alias[s] = l;
+        p[l] = (p[l] + p[s]) - 1.0f;
+        if (p[l] < 1.0f)
+        {
+            --nLarge;
+            work[nSmall++] = l;
+        }
+    }
+
+    // Leftovers only differ from 1 by rounding
+    while (nLarge > 0)
+    {
+        p[work[n - nLarge--]] = 1.0f;
+    }
+    while (nSmall > 0)
+    {
+        p[work[--nSmall]] = 1.0f;
+    }
+}
+
+static void init_alias_table(AliasTable *table, DynamicArray<float> *weights, float slack=0.0f, Arena *arena=NULL)
+{
+    int32_t n = weights->size;
+    SDL_assert(n > 0);
+    SDL_assert(slack >= 0);
+    table->slack = slack;
+
+    init_dynamic_array(&table->weights, n, false, arena);
+    init_dynamic_array(&table->bounds, n, false, arena);
+    init_dynamic_array(&table->probabilities, n, false, arena);
+    init_dynamic_array(&table->aliases, n, false, arena);
+    init_dynamic_array(&table->worklist, n, false, arena);
+    table->weights.append(weights->data, n);
+    table->bounds.size = n;
+    table->probabilities.size = n;
+    table->aliases.size = n;
+    table->worklist.size = n;
+
+    rebuild_alias_table(table);
+}
+
+static void delete_alias_table(AliasTable *table)
+{
+    // Reverse order of allocation, for arenas
+    delete_dynamic_array(&table->worklist);
+    delete_dynamic_array(&table->aliases);
+    delete_dynamic_array(&table->probabilities);
+    delete_dynamic_array(&table->bounds);
+    delete_dynamic_array(&table->weights);
+}
+
+static void set_alias_weight(AliasTable *table, int32_t index, float weight)
+{
+    SDL_assert(index >= 0 && index < table->weights.size);
+    SDL_assert(weight >= 0);
+    table->totalWeight += weight - table->weights.data[index];
+    table->weights.data[index] = weight;
+
+    if (weight > table->bounds.data[index] || 2.0f*(1.0f + table->slack)*table->totalWeight < table->totalBound)
+    {
+        table->needsRebuild = true;
+    }
+}
+
+static int alias_rand_i(RandomEngine *engine, AliasTable *table, int minV)
+{
+    if (table->needsRebuild)
+    {
+        rebuild_alias_table(table);
+    }
+    if (table->totalWeight <= 0)
+    {
+        // Same as weighted_rand_i() with all weights zero
+        return minV;
+    }
+
+    uint32_t n = (uint32_t) table->weights.size;
+    while (true)
+    {
+        // High bits pick the column, low 24 bits the coin
+        uint64_t r = rand_u64(engine);
+        int32_t i = (int32_t) ((uint64_t(uint32_t(r >> 32))*n) >> 32);
+        float coin = float(r & 0xFFFFFF)*(1.0f/16777216.0f);
+        int32_t j = coin < table->probabilities.data[i] ? i : table->aliases.data[i];
+
+        float weight = table->weights.data[j];
+        float bound = table->bounds.data[j];
+        if (weight > 0 && (weight >= bound || rand_f(engine, 0, bound) < weight))
+        {
+            return minV + j;
+        }
+    }
+}
+
+#endif //ALIAS_TABLE_H
@@ -0,0 +1,277 @@
+#ifndef CONCURRENT_HASH_TABLE_H
+#define CONCURRENT_HASH_TABLE_H
+
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include <atomic>
+#include <thread>
+#include <type_traits>
+
+#include "SDL_assert.h"
+
+#include "dynamic_array.h"
+#include "hash_table.h"
+#include "hasher.h"
+
+// Retries of an optimistic read before it queues up behind the writers
+#define CONCURRENT_READ_RETRIES 64
+
+// One HashTable behind a spinlock for writers and a sequence counter for
+// readers. The sequence is odd while a write is in progress, readers copy
+// their value out and retry if it changed in the meantime.
+template<typename K, typename V, typename H>
+struct alignas(64) ConcurrentShard
+{
+    std::atomic<uint32_t> sequence;
+    std::atomic<bool> locked;
+    std::atomic<HashTable<K, V, H> *> table;
+    // Replaced tables stay valid for readers until the map is deleted
+    DynamicArray<HashTable<K, V, H> *> retired;
+};
+
+// Concurrent hash table: keys are spread over a power of two number of
+// shards by the high hash bits. Reads take no lock unless they keep racing
+// a writer on the same shard. Values are returned by copy, no pointers into
+// the table are handed out. Not for use with arenas.
+//
+// Optimistic reads compare keys and copy values while a writer may be
+// changing them and only discard the result afterwards, so K and V must be
+// trivially copyable. Types that own memory or follow pointers in == could
+// crash before the sequence check catches the torn read.
+template<typename K, typename V, typename H=Hasher<K>>
+struct ConcurrentHashTable
+{
+    static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+                  "ConcurrentHashTable reads racing writers, keys and values must be trivially copyable");
+
+    int32_t nShards;
+    int32_t shardShift;
+    ConcurrentShard<K, V, H> *shards;
+
+    int32_t size();
+
+    bool get_value(K *key, V *value);
+    V get_or_default_value(K *key, V default_value);
+    void set_value(K *key, V *value);
+    void set_value(K key, V value);
+    template<typename F>
+    V upsert(K *key, V default_value, F update);
+    bool remove(K *key);
+
+    ConcurrentShard<K, V, H> *get_shard(K *key);
+    void lock(ConcurrentShard<K, V, H> *shard);
+    void unlock(ConcurrentShard<K, V, H> *shard);
+    void reserve_one(ConcurrentShard<K, V, H> *shard);
+};
+
+template<typename K, typename V, typename H>
+void init_concurrent_hash_table(ConcurrentHashTable<K, V, H> *map, int32_t capacity, int32_t nShards=64)
+{
+    nShards = round_up_power_of_two(nShards);
+    map->nShards = nShards;
+    map->shardShift = 32;
+    for (int32_t n=nShards; n>1; n/=2)
+    {
+        --map->shardShift;
+    }
+
+    int32_t shardCapacity = max_i(capacity/nShards, 16);
+    map->shards = new ConcurrentShard<K, V, H>[nShards];
+    for (int32_t i=0; i<nShards; ++i)
+    {
+        ConcurrentShard<K, V, H> *shard = &map->shards[i];
+        HashTable<K, V, H> *table = (HashTable<K, V, H> *) malloc(sizeof(HashTable<K, V, H>));
+        init_hash_table(table, shardCapacity);
+        shard->sequence.store(0);
+        shard->locked.store(false);
+        shard->table.store(table);
+        init_dynamic_array(&shard->retired, 32, true);
+    }
+}
+
+template<typename K, typename V, typename H>
+void delete_concurrent_hash_table(ConcurrentHashTable<K, V, H> *map)
+{
+    for (int32_t i=0; i<map->nShards; ++i)
+    {
+        ConcurrentShard<K, V, H> *shard = &map->shards[i];
+        shard->retired.append(shard->table.load());
+        for (int32_t j=0; j<shard->retired.size; ++j)
+        {
+            delete_hash_table(shard->retired.data[j]);
+            free(shard->retired.data[j]);
+        }
+        delete_dynamic_array(&shard->retired);
+    }
+    delete[] map->shards;
+    map->shards = NULL;
+    map->nShards = 0;
+}
+
+template<typename K, typename V, typename H>
+ConcurrentShard<K, V, H> *ConcurrentHashTable<K, V, H>::get_shard(K *key)
+{
+    // The tables index with the low bits, so shard by the high ones
+    uint32_t hash = H::hash(*key);
+    return &shards[shardShift == 32 ? 0 : hash >> shardShift];
+}
+
+template<typename K, typename V, typename H>
+void ConcurrentHashTable<K, V, H>::lock(ConcurrentShard<K, V, H> *shard)
+{
+    while (shard->locked.exchange(true, std::memory_order_acquire))
+    {
+        while (shard->locked.load(std::memory_order_relaxed))
+        {
+            std::this_thread::yield();
+        }
+    }
+    uint32_t sequence = shard->sequence.load(std::memory_order_relaxed);
+    shard->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+template<typename K, typename V, typename H>
+void ConcurrentHashTable<K, V, H>::unlock(ConcurrentShard<K, V, H> *shard)
+{
+    uint32_t sequence = shard->sequence.load(std::memory_order_relaxed);
+    shard->sequence.store(sequence + 1, std::memory_order_release);
+    shard->locked.store(false, std::memory_order_release);
+}
+
+template<typename K, typename V, typename H>
+void ConcurrentHashTable<K, V, H>::reserve_one(ConcurrentShard<K, V, H> *shard)
+{
+    // HashTable would free its items when growing under a reader, so grow
+    // into a fresh table instead and retire the old one
+    HashTable<K, V, H> *table = shard->table.load(std::memory_order_relaxed);
+    if (float(table->nOccupied + 1)/float(table->capacity) <= 0.5f)
+    {
+        return;
+    }
+
+    HashTable<K, V, H> *grown = (HashTable<K, V, H> *) malloc(sizeof(HashTable<K, V, H>));
+    init_hash_table(grown, 2*table->capacity);
+    for (int32_t i=0; i<table->capacity; ++i)
+    {
+        if (table->items.data[i].occupied)
+        {
+            grown->set_value(&table->items.data[i].key, table->value_at(i));
+        }
+    }
+    shard->retired.append(table);
+    shard->table.store(grown, std::memory_order_release);
+}
+
+template<typename K, typename V, typename H>
+int32_t ConcurrentHashTable<K, V, H>::size()
+{
+    // Not a snapshot while writers are active
+    int32_t result = 0;
+    for (int32_t i=0; i<nShards; ++i)
+    {
+        result += shards[i].table.load(std::memory_order_acquire)->nOccupied;
+    }
+    return result;
+}
+
+template<typename K, typename V, typename H>
+bool ConcurrentHashTable<K, V, H>::get_value(K *key, V *value)
+{
+    ConcurrentShard<K, V, H> *shard = get_shard(key);
+
+    for (int32_t attempt=0; attempt<CONCURRENT_READ_RETRIES; ++attempt)
+    {
+        uint32_t before = shard->sequence.load(std::memory_order_acquire);
+        if (before & 1)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        HashTable<K, V, H> *table = shard->table.load(std::memory_order_acquire);
+        V *found = table->get_value(key);
+        V copy;
+        if (found != NULL)
+        {
+            copy = *found;
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (shard->sequence.load(std::memory_order_relaxed) == before)
+        {
+            if (found != NULL)
+            {
+                *value = copy;
+            }
+            return found != NULL;
+        }
+    }
+
+    lock(shard);
+    V *found = shard->table.load(std::memory_order_relaxed)->get_value(key);
+    if (found != NULL)
+    {
+        *value = *found;
+    }
+    unlock(shard);
+    return found != NULL;
+}
+
+// Like HashTable, inserts default_value if the key is missing. Hits stay on
+// the lock-free read path.
+template<typename K, typename V, typename H>
+V ConcurrentHashTable<K, V, H>::get_or_default_value(K *key, V default_value)
+{
+    V value;
+    if (get_value(key, &value))
+    {
+        return value;
+    }
+    return upsert(key, default_value, [](V *) {});
+}
+
+template<typename K, typename V, typename H>
+void ConcurrentHashTable<K, V, H>::set_value(K *key, V *value)
+{
+    ConcurrentShard<K, V, H> *shard = get_shard(key);
+    lock(shard);
+    reserve_one(shard);
+    shard->table.load(std::memory_order_relaxed)->set_value(key, value);
+    unlock(shard);
+}
+
+template<typename K, typename V, typename H>
+void ConcurrentHashTable<K, V, H>::set_value(K key, V value)
+{
+    set_value(&key, &value);
+}
+
+// Inserts default_value if the key is missing, then calls update(V *) on the
+// stored value while the shard is locked. Returns the updated value.
+template<typename K, typename V, typename H>
+template<typename F>
+V ConcurrentHashTable<K, V, H>::upsert(K *key, V default_value, F update)
+{
+    ConcurrentShard<K, V, H> *shard = get_shard(key);
+    lock(shard);
+    reserve_one(shard);
+    V *value = shard->table.load(std::memory_order_relaxed)->get_or_default_value(key, &default_value);
+    update(value);
+    V result = *value;
+    unlock(shard);
+    return result;
+}
+
+template<typename K, typename V, typename H>
+bool ConcurrentHashTable<K, V, H>::remove(K *key)
+{
+    ConcurrentShard<K, V, H> *shard = get_shard(key);
+    lock(shard);
+    bool removed = shard->table.load(std::memory_order_relaxed)->remove(key);
+    unlock(shard);
+    return removed;
+}
+
+#endif //CONCURRENT_HASH_TABLE_H
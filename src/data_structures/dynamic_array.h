@@ -7,6 +7,7 @@
 
 #include "SDL_assert.h"
 
+#include "sort.h"
 #include "../common.h"
 
 struct Arena;
@@ -46,6 +47,10 @@ struct DynamicArray
     int32_t append_unique(T *element);
     int32_t append_unique(T element);
     void sort(int (*compFunction)(const void*, const void*));
+    template<typename F>
+    void sort_by(F key);
+    template<typename F>
+    void radix_sort_by(F key);
     void reorder(DynamicArray<IndexedFloat> *ordering, bool inverse);
     void randomize(RandomEngine *random);
     void copy(DynamicArray<T> *target);
@@ -54,7 +59,7 @@ struct DynamicArray
 template<typename T>
 void init_dynamic_array(DynamicArray<T> *array, int32_t cap, bool allowedToGrow=false, Arena *arena=NULL)
 {
-    SDL_assert((cap > 0 || cap == -1) && cap < 100000);
+    SDL_assert(cap > 0 || cap == -1);
     array->arena = arena;
     array->size = 0;
     array->capacity = cap;
@@ -311,23 +316,62 @@ void DynamicArray<T>::sort(int (*compFunction)(const void*, const void*))
     qsort(data, size, sizeof(T), compFunction);
 }
 
+// Introsort on key(element), compared with <
+template<typename T>
+template<typename F>
+void DynamicArray<T>::sort_by(F key)
+{
+    introsort(data, size, [&key](const T &a, const T &b) { return key(a) < key(b); });
+}
+
+// Stable radix sort, key(element) returns a float or an integer
+template<typename T>
+template<typename F>
+void DynamicArray<T>::radix_sort_by(F key)
+{
+    radix_sort(data, size, key, arena);
+}
+
+// Element i becomes the element at ordering[i].index, or ordering counted
+// from the back if inverse. Done in place by following the cycles of the
+// permutation, visited entries of ordering are marked by flipping their
+// index and restored afterwards.
 template<typename T>
 void DynamicArray<T>::reorder(DynamicArray<IndexedFloat> *ordering, bool inverse)
 {
     SDL_assert(ordering->size == size);
-    int32_t offset = 0;
-    if (inverse)
+    IndexedFloat *order = ordering->data;
+    int32_t last = size - 1;
+
+    for (int32_t start=0; start<size; ++start)
     {
-        offset = size - 1;
+        int32_t *startIndex = &order[inverse ? last - start : start].index;
+        if (*startIndex < 0)
+        {
+            continue;
+        }
+
+        T first = data[start];
+        int32_t i = start;
+        while (true)
+        {
+            int32_t *index = &order[inverse ? last - i : i].index;
+            int32_t source = *index;
+            *index = ~source;
+            if (source == start)
+            {
+                data[i] = first;
+                break;
+            }
+            data[i] = data[source];
+            i = source;
+        }
     }
 
-    T *newData = allocate_data();
-    for (int32_t i=0; i<ordering->size; ++i)
+    for (int32_t i=0; i<size; ++i)
     {
-        newData[i] = data[ordering->data[offset - i].index];
+        order[i].index = ~order[i].index;
     }
-    arena_free(arena, data);
-    data = newData;
 }
 
 template<typename T>
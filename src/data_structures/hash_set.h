@@ -8,6 +8,8 @@
 #include "SDL_assert.h"
 
 #include "dynamic_array.h"
+#include "hasher.h"
+#include "prefetch.h"
 #include "../common.h"
 
 #define DYNAMIC_ARRAY_CAPACITY 4
@@ -19,8 +21,8 @@ struct Element
     K key;
 };
 
-// Hash set
-template<typename K>
+// Hash set, linear probing over a power of two capacity
+template<typename K, typename H=Hasher<K>>
 struct HashSet
 {
     int nElems;
@@ -35,13 +37,18 @@ struct HashSet
     void add(K *key);
     void add(K key);
     bool remove(K *key);
+    void contains_many(K *keys, bool *results, int n);
+    void add_many(K *keys, int n);
 
+    bool contains_hashed(K *key, uint32_t hash);
+    void add_hashed(K *key, uint32_t hash);
+    void erase_index(int index);
     int compute_hash(K key);
     int double_capacity();
 };
 
-template<typename K>
-void reset_hash_set(HashSet<K> *set)
+template<typename K, typename H>
+void reset_hash_set(HashSet<K, H> *set)
 {
     set->nElems = 0;
     set->elems.size = set->capacity;
@@ -52,37 +59,42 @@ void reset_hash_set(HashSet<K> *set)
     }
 }
 
-template<typename K>
-void init_hash_set(HashSet<K> *set, int capacity, Arena *arena=NULL)
+template<typename K, typename H>
+void init_hash_set(HashSet<K, H> *set, int capacity, Arena *arena=NULL)
 {
-    set->capacity = capacity;
+    set->capacity = round_up_power_of_two(capacity);
     set->arena = arena;
-    init_dynamic_array(&set->elems, capacity, false, arena);
+    init_dynamic_array(&set->elems, set->capacity, false, arena);
     reset_hash_set(set);
 }
 
-template<typename K>
-void delete_hash_set(HashSet<K> *set)
+template<typename K, typename H>
+void delete_hash_set(HashSet<K, H> *set)
 {
     set->capacity = 0;
     delete_dynamic_array(&set->elems);
 }
 
-template<typename K>
-float HashSet<K>::load_factor()
+template<typename K, typename H>
+float HashSet<K, H>::load_factor()
 {
     return float(nElems)/float(capacity);
 }
 
-template<typename K>
-bool HashSet<K>::contains(K *key)
+template<typename K, typename H>
+bool HashSet<K, H>::contains(K *key)
 {
-    int hash = compute_hash(*key);
-    SDL_assert(hash < capacity);
+    return contains_hashed(key, H::hash(*key));
+}
 
-    for (int i=hash; i<elems.size + hash; ++i)
+template<typename K, typename H>
+bool HashSet<K, H>::contains_hashed(K *key, uint32_t hash)
+{
+    int start = (int) (hash & uint32_t(capacity - 1));
+
+    for (int i=start; i<elems.size + start; ++i)
     {
-        Element<K> *elem = &elems.data[i % elems.size];
+        Element<K> *elem = &elems.data[i & (capacity - 1)];
         if (!elem->occupied)
         {
             return false;
@@ -95,26 +107,32 @@ bool HashSet<K>::contains(K *key)
     return false;
 }
 
-template<typename K>
-bool HashSet<K>::contains(K key)
+template<typename K, typename H>
+bool HashSet<K, H>::contains(K key)
 {
     return contains(&key);
 }
 
-template<typename K>
-void HashSet<K>::add(K *key)
+template<typename K, typename H>
+void HashSet<K, H>::add(K *key)
+{
+    add_hashed(key, H::hash(*key));
+}
+
+template<typename K, typename H>
+void HashSet<K, H>::add_hashed(K *key, uint32_t hash)
 {
     if (load_factor() > 0.5)
     {
         double_capacity();
     }
 
-    int hash = compute_hash(*key);
+    int start = (int) (hash & uint32_t(capacity - 1));
 
-    int i=hash;
-    for (; i<elems.size + hash; ++i)
+    int i=start;
+    for (; i<elems.size + start; ++i)
     {
-        Element<K> *elem = &elems.data[i % elems.size];
+        Element<K> *elem = &elems.data[i & (capacity - 1)];
         if (!elem->occupied)
         {
             break;
@@ -125,7 +143,7 @@ void HashSet<K>::add(K *key)
         }
     }
 
-    Element<K> *elem = &elems.data[i];
+    Element<K> *elem = &elems.data[i & (capacity - 1)];
     SDL_assert(elem->occupied == false);
 
     elem->occupied = true;
@@ -135,42 +153,113 @@ void HashSet<K>::add(K *key)
     return;
 }
 
-template<typename K>
-void HashSet<K>::add(K key)
+template<typename K, typename H>
+void HashSet<K, H>::add(K key)
 {
     return add(&key);
 }
 
-template<typename K>
-bool HashSet<K>::remove(K *key)
+template<typename K, typename H>
+bool HashSet<K, H>::remove(K *key)
 {
     int hash = compute_hash(*key);
 
-    for (int i=hash; i<elems->size + hash; ++i)
+    int i = hash;
+    for (; i<elems.size + hash; ++i)
     {
-        Element<K> *elem = &elems->data[i % elems.size];
+        Element<K> *elem = &elems.data[i & (capacity - 1)];
         if (!elem->occupied)
         {
             return false;
         }
         else if (*key == elem->key)
         {
-            elem->occupied = false;
-            return true;
+            break;
         }
     }
-    return false;
+    if (i == elems.size + hash)
+    {
+        return false;
+    }
+
+    erase_index(i & (capacity - 1));
+    --nElems;
+    return true;
 }
 
-template<typename K>
-int HashSet<K>::compute_hash(K key)
+template<typename K, typename H>
+void HashSet<K, H>::erase_index(int index)
+{
+    // Backward shift deletion, see HashTable::erase_index
+    int hole = index;
+    int j = hole;
+    while (true)
+    {
+        j = (j + 1) & (capacity - 1);
+        Element<K> *elem = &elems.data[j];
+        if (!elem->occupied)
+        {
+            break;
+        }
+
+        int home = compute_hash(elem->key);
+        bool canMove = (hole <= j) ? (home <= hole || home > j) : (home <= hole && home > j);
+        if (canMove)
+        {
+            elems.data[hole] = *elem;
+            hole = j;
+        }
+    }
+    elems.data[hole].occupied = false;
+}
+
+// Batched like HashTable::get_many
+template<typename K, typename H>
+void HashSet<K, H>::contains_many(K *keys, bool *results, int n)
 {
-    uint32_t hash = hash_bytes((uint8_t *) &key, sizeof(K));
-    return (int) (hash % capacity);
+    uint32_t hashes[HASH_PREFETCH_BATCH];
+    for (int first=0; first<n; first+=HASH_PREFETCH_BATCH)
+    {
+        int count = min_i(n - first, HASH_PREFETCH_BATCH);
+        for (int i=0; i<count; ++i)
+        {
+            hashes[i] = H::hash(keys[first + i]);
+            prefetch_address(&elems.data[hashes[i] & uint32_t(capacity - 1)]);
+        }
+        for (int i=0; i<count; ++i)
+        {
+            results[first + i] = contains_hashed(&keys[first + i], hashes[i]);
+        }
+    }
 }
 
-template<typename K>
-int HashSet<K>::double_capacity()
+template<typename K, typename H>
+void HashSet<K, H>::add_many(K *keys, int n)
+{
+    uint32_t hashes[HASH_PREFETCH_BATCH];
+    for (int first=0; first<n; first+=HASH_PREFETCH_BATCH)
+    {
+        int count = min_i(n - first, HASH_PREFETCH_BATCH);
+        for (int i=0; i<count; ++i)
+        {
+            hashes[i] = H::hash(keys[first + i]);
+            prefetch_address(&elems.data[hashes[i] & uint32_t(capacity - 1)]);
+        }
+        for (int i=0; i<count; ++i)
+        {
+            add_hashed(&keys[first + i], hashes[i]);
+        }
+    }
+}
+
+template<typename K, typename H>
+int HashSet<K, H>::compute_hash(K key)
+{
+    return (int) (H::hash(key) & uint32_t(capacity - 1));
+}
+
+template<typename K, typename H>
+int HashSet<K, H>::double_capacity()
 {
     printf("Hash set double capacity\n");
     int oldCapacity = capacity;
@@ -4,12 +4,21 @@
 #include "stdlib.h"
 #include "stdio.h"
 #include "string.h"
+#include <type_traits>
 
 #include "SDL_assert.h"
 
 #include "dynamic_array.h"
+#include "hasher.h"
+#include "prefetch.h"
 #include "../common.h"
 
+// Old slots moved per insert/remove while an incremental resize is running
+#define HASH_TABLE_MIGRATION_STEP 16
+
+// Values above this size go to a separate array by default
+#define HASH_TABLE_SPLIT_VALUE_SIZE 32
+
 template<typename K, typename V>
 struct Item
 {
@@ -18,16 +27,41 @@ struct Item
     V value;
 };
 
-// Hash table
-template<typename K, typename V>
+template<typename K>
+struct KeyItem
+{
+    bool occupied;
+    K key;
+};
+
+// Hash table, linear probing over a power of two capacity
+//
+// With incremental set, growing keeps the old items next to the new ones and
+// every insert/remove moves HASH_TABLE_MIGRATION_STEP old slots over, so no
+// single operation pays for a full rehash. Old slots below migrated are
+// already moved and cleared, probes in the old array skip over them.
+//
+// With SplitValues the items only hold keys and values live in a parallel
+// array that is read on a hit, so probes over large values stay dense.
+template<typename K, typename V, typename H=Hasher<K>, bool SplitValues=(sizeof(V) > HASH_TABLE_SPLIT_VALUE_SIZE)>
 struct HashTable
 {
+    typedef typename std::conditional<SplitValues, KeyItem<K>, Item<K, V>>::type Slot;
+
     int32_t nOccupied;
     int32_t capacity;
     Arena *arena;
-    DynamicArray<Item<K, V>> items;
+    DynamicArray<Slot> items;
+    V *values;
+
+    bool incremental;
+    int32_t migrated;
+    int32_t oldCapacity;
+    Slot *oldItems;
+    V *oldValues;
 
     float load_factor();
+    bool migrating();
 
     V *get_value(K *key);
     V get_value(K key);
@@ -37,14 +71,29 @@ struct HashTable
     V *get_or_default_value(K *key, V *default_value);
     V *get_or_default_value(K *key, V default_value);
     bool remove(K *key);
+    void get_many(K *keys, V **results, int32_t n);
+    void insert_many(K *keys, V *newValues, int32_t n);
 
+    V *value_at(int32_t index);
+    V *old_value_at(int32_t index);
     int32_t compute_hash(K key);
+    int32_t find_index(K *key, uint32_t hash);
+    int32_t find_old_index(K *key, uint32_t hash);
+    int32_t insert_index(K *key, uint32_t hash);
+    V *find_value(K *key, uint32_t hash);
+    V *find_or_insert(K *key, uint32_t hash, bool *inserted);
+    void erase_index(int32_t index);
+    void erase_old_index(int32_t index);
+    void move_old_slot(int32_t index);
+    void migrate(int32_t nSlots);
+    void free_old_items();
     int32_t double_capacity();
 };
 
-template<typename K, typename V>
-void reset_hash_table(HashTable<K, V> *table)
+template<typename K, typename V, typename H, bool S>
+void reset_hash_table(HashTable<K, V, H, S> *table)
 {
+    table->free_old_items();
     table->nOccupied = 0;
     table->items.size = table->capacity;
 
@@ -54,202 +103,471 @@ void reset_hash_table(HashTable<K, V> *table)
     }
 }
 
-template<typename K, typename V>
-void init_hash_table(HashTable<K, V> *table, int32_t capacity, Arena *arena=NULL)
+template<typename K, typename V, typename H, bool S>
+void init_hash_table(HashTable<K, V, H, S> *table, int32_t capacity, Arena *arena=NULL, bool incremental=false)
 {
-    table->capacity = capacity;
+    table->capacity = round_up_power_of_two(capacity);
     table->arena = arena;
-    init_dynamic_array(&table->items, capacity, false, arena);
+    table->incremental = incremental;
+    table->oldItems = NULL;
+    table->oldValues = NULL;
+    table->values = NULL;
+    init_dynamic_array(&table->items, table->capacity, false, arena);
+    if (S)
+    {
+        table->values = (V *) arena_alloc(arena, table->capacity*sizeof(V));
+        SDL_assert(table->values != NULL);
+    }
     reset_hash_table(table);
 }
 
-template<typename K, typename V>
-void delete_hash_table(HashTable<K, V> *table)
+template<typename K, typename V, typename H, bool S>
+void delete_hash_table(HashTable<K, V, H, S> *table)
 {
+    table->free_old_items();
     table->capacity = 0;
+    if (S)
+    {
+        arena_free(table->arena, table->values);
+        table->values = NULL;
+    }
     delete_dynamic_array(&table->items);
 }
 
-template<typename K, typename V>
-float HashTable<K, V>::load_factor()
+template<typename K, typename V, typename H, bool S>
+float HashTable<K, V, H, S>::load_factor()
 {
     return float(nOccupied)/float(capacity);
 }
 
-template<typename K, typename V>
-V *HashTable<K, V>::get_value(K *key)
+template<typename K, typename V, typename H, bool S>
+bool HashTable<K, V, H, S>::migrating()
+{
+    return oldItems != NULL;
+}
+
+template<typename K, typename V, typename H, bool S>
+V *HashTable<K, V, H, S>::value_at(int32_t index)
+{
+    if constexpr (S)
+    {
+        return &values[index];
+    }
+    else
+    {
+        return &items.data[index].value;
+    }
+}
+
+template<typename K, typename V, typename H, bool S>
+V *HashTable<K, V, H, S>::old_value_at(int32_t index)
 {
-    int32_t hash = compute_hash(*key);
-    SDL_assert(hash < capacity);
+    if constexpr (S)
+    {
+        return &oldValues[index];
+    }
+    else
+    {
+        return &oldItems[index].value;
+    }
+}
 
-    for (int32_t i=hash; i<items.size + hash; ++i)
+template<typename K, typename V, typename H, bool S>
+int32_t HashTable<K, V, H, S>::find_index(K *key, uint32_t hash)
+{
+    int32_t start = int32_t(hash & uint32_t(capacity - 1));
+
+    for (int32_t i=start; i<items.size + start; ++i)
     {
-        Item<K, V> *item = &items.data[i % items.size];
+        Slot *item = &items.data[i & (capacity - 1)];
         if (!item->occupied)
         {
-            return NULL;
+            return -1;
         }
         else if (*key == item->key)
         {
-            return &item->value;
+            return i & (capacity - 1);
         }
     }
-    return NULL;
+    return -1;
 }
 
-template<typename K, typename V>
-V HashTable<K, V>::get_value(K key)
+template<typename K, typename V, typename H, bool S>
+int32_t HashTable<K, V, H, S>::find_old_index(K *key, uint32_t hash)
 {
-    V *value = get_value(&key);
-    if (value == NULL)
+    if (!migrating())
     {
-        printf("ERROR] key '%d' not available\n", key);
-        SDL_assert(false);
+        return -1;
     }
-    return *value;
-}
 
-template<typename K, typename V>
-V* HashTable<K, V>::set_value(K *key, V *value)
-{
-    if (load_factor() > 0.5)
+    int32_t mask = oldCapacity - 1;
+    int32_t i = int32_t(hash & uint32_t(mask));
+    for (int32_t n=0; n<oldCapacity; ++n, i=(i + 1) & mask)
     {
-        double_capacity();
+        if (i < migrated)
+        {
+            // Skip the moved part, the chain continues behind it
+            n += migrated - i - 1;
+            i = migrated - 1;
+            continue;
+        }
+        Slot *item = &oldItems[i];
+        if (!item->occupied)
+        {
+            return -1;
+        }
+        else if (*key == item->key)
+        {
+            return i;
+        }
     }
+    return -1;
+}
 
-    int32_t hash = compute_hash(*key);
+template<typename K, typename V, typename H, bool S>
+int32_t HashTable<K, V, H, S>::insert_index(K *key, uint32_t hash)
+{
+    // Key must not be in the table yet
+    int32_t start = int32_t(hash & uint32_t(capacity - 1));
 
-    int32_t i = hash;
-    for (; i<items.size + hash; ++i)
+    int32_t i = start;
+    for (; i<items.size + start; ++i)
     {
-        Item<K, V> *item = &items.data[i % items.size];
-        if (!item->occupied)
+        if (!items.data[i & (capacity - 1)].occupied)
         {
             break;
         }
-        else if (*key == item->key)
-        {
-            item->value = *value;
-            return &item->value;
-        }
     }
 
-    Item<K, V> *item = &items.data[i];
+    Slot *item = &items.data[i & (capacity - 1)];
     SDL_assert(item->occupied == false);
 
     item->occupied = true;
     item->key = *key;
-    item->value =  *value;
+    return i & (capacity - 1);
+}
+
+template<typename K, typename V, typename H, bool S>
+V *HashTable<K, V, H, S>::find_or_insert(K *key, uint32_t hash, bool *inserted)
+{
+    if (migrating())
+    {
+        migrate(HASH_TABLE_MIGRATION_STEP);
+    }
+    if (load_factor() > 0.5)
+    {
+        double_capacity();
+    }
+
+    *inserted = false;
+    int32_t index = find_index(key, hash);
+    if (index >= 0)
+    {
+        return value_at(index);
+    }
+
+    // Live keys of the old array are updated where they are
+    index = find_old_index(key, hash);
+    if (index >= 0)
+    {
+        return old_value_at(index);
+    }
 
     ++nOccupied;
-    return &item->value;
+    *inserted = true;
+    return value_at(insert_index(key, hash));
 }
 
-template<typename K, typename V>
-V* HashTable<K, V>::set_value(K key, V value)
+template<typename K, typename V, typename H, bool S>
+V *HashTable<K, V, H, S>::find_value(K *key, uint32_t hash)
+{
+    int32_t index = find_index(key, hash);
+    if (index >= 0)
+    {
+        return value_at(index);
+    }
+    index = find_old_index(key, hash);
+    return index < 0 ? NULL : old_value_at(index);
+}
+
+template<typename K, typename V, typename H, bool S>
+V *HashTable<K, V, H, S>::get_value(K *key)
+{
+    return find_value(key, H::hash(*key));
+}
+
+template<typename K, typename V, typename H, bool S>
+V HashTable<K, V, H, S>::get_value(K key)
+{
+    V *value = get_value(&key);
+    if (value == NULL)
+    {
+        printf("ERROR] key '%d' not available\n", key);
+        SDL_assert(false);
+    }
+    return *value;
+}
+
+template<typename K, typename V, typename H, bool S>
+V* HashTable<K, V, H, S>::set_value(K *key, V *value)
+{
+    bool inserted;
+    V *result = find_or_insert(key, H::hash(*key), &inserted);
+    *result = *value;
+    return result;
+}
+
+template<typename K, typename V, typename H, bool S>
+V* HashTable<K, V, H, S>::set_value(K key, V value)
 {
     return set_value(&key, &value);
 }
 
-template<typename K, typename V>
-V* HashTable<K, V>::set_value(K *key, V value)
+template<typename K, typename V, typename H, bool S>
+V* HashTable<K, V, H, S>::set_value(K *key, V value)
 {
     return set_value(key, &value);
 }
 
-template<typename K, typename V>
-V* HashTable<K, V>::get_or_default_value(K *key, V *default_value)
+template<typename K, typename V, typename H, bool S>
+V* HashTable<K, V, H, S>::get_or_default_value(K *key, V *default_value)
 {
-    if (load_factor() > 0.5)
+    bool inserted;
+    V *result = find_or_insert(key, H::hash(*key), &inserted);
+    if (inserted)
     {
-        double_capacity();
+        *result = *default_value;
     }
+    return result;
+}
 
-    int32_t hash = compute_hash(*key);
+template<typename K, typename V, typename H, bool S>
+V* HashTable<K, V, H, S>::get_or_default_value(K *key, V default_value)
+{
+    return get_or_default_value(key, &default_value);
+}
 
-    int32_t i = hash;
-    for (; i<items.size + hash; ++i)
+template<typename K, typename V, typename H, bool S>
+bool HashTable<K, V, H, S>::remove(K *key)
+{
+    if (migrating())
     {
-        Item<K, V> *item = &items.data[i % items.size];
-        if (!item->occupied)
+        migrate(HASH_TABLE_MIGRATION_STEP);
+    }
+
+    uint32_t hash = H::hash(*key);
+    int32_t index = find_index(key, hash);
+    if (index >= 0)
+    {
+        erase_index(index);
+        --nOccupied;
+        return true;
+    }
+
+    index = find_old_index(key, hash);
+    if (index >= 0)
+    {
+        erase_old_index(index);
+        --nOccupied;
+        return true;
+    }
+    return false;
+}
+
+// Looks up n keys, results[i] is NULL for a missing key. All keys of a batch
+// are hashed and their slots prefetched before the first probe, so the cache
+// misses overlap instead of being paid one after another.
+template<typename K, typename V, typename H, bool S>
+void HashTable<K, V, H, S>::get_many(K *keys, V **results, int32_t n)
+{
+    uint32_t hashes[HASH_PREFETCH_BATCH];
+    for (int32_t first=0; first<n; first+=HASH_PREFETCH_BATCH)
+    {
+        int32_t count = min_i(n - first, HASH_PREFETCH_BATCH);
+        for (int32_t i=0; i<count; ++i)
         {
-            break;
+            hashes[i] = H::hash(keys[first + i]);
+            prefetch_address(&items.data[hashes[i] & uint32_t(capacity - 1)]);
         }
-        else if (*key == item->key)
+        for (int32_t i=0; i<count; ++i)
         {
-            SDL_assert(&item->value != NULL);
-            return &item->value;
+            results[first + i] = find_value(&keys[first + i], hashes[i]);
         }
     }
+}
 
-    Item<K, V>* item = &items.data[i];
-    SDL_assert(item->occupied == false);
+// set_value for n keys, batched like get_many
+template<typename K, typename V, typename H, bool S>
+void HashTable<K, V, H, S>::insert_many(K *keys, V *newValues, int32_t n)
+{
+    uint32_t hashes[HASH_PREFETCH_BATCH];
+    for (int32_t first=0; first<n; first+=HASH_PREFETCH_BATCH)
+    {
+        int32_t count = min_i(n - first, HASH_PREFETCH_BATCH);
+        for (int32_t i=0; i<count; ++i)
+        {
+            hashes[i] = H::hash(keys[first + i]);
+            prefetch_address(&items.data[hashes[i] & uint32_t(capacity - 1)]);
+        }
+        for (int32_t i=0; i<count; ++i)
+        {
+            // A resize within the batch only wastes the remaining prefetches
+            bool inserted;
+            *find_or_insert(&keys[first + i], hashes[i], &inserted) = newValues[first + i];
+        }
+    }
+}
 
-    item->occupied = true;
-    item->key = *key;
-    item->value = *default_value;
+template<typename K, typename V, typename H, bool S>
+void HashTable<K, V, H, S>::erase_index(int32_t index)
+{
+    // Backward shift deletion: pull later items of the probe chain into the
+    // hole, unless that would move them in front of their own hash slot
+    int32_t hole = index;
+    int32_t j = hole;
+    while (true)
+    {
+        j = (j + 1) & (capacity - 1);
+        Slot *item = &items.data[j];
+        if (!item->occupied)
+        {
+            break;
+        }
 
-    ++nOccupied;
-    return &item->value;
+        int32_t home = compute_hash(item->key);
+        bool canMove = (hole <= j) ? (home <= hole || home > j) : (home <= hole && home > j);
+        if (canMove)
+        {
+            items.data[hole] = *item;
+            if constexpr (S)
+            {
+                values[hole] = values[j];
+            }
+            hole = j;
+        }
+    }
+    items.data[hole].occupied = false;
 }
 
-template<typename K, typename V>
-V* HashTable<K, V>::get_or_default_value(K *key, V default_value)
+template<typename K, typename V, typename H, bool S>
+void HashTable<K, V, H, S>::move_old_slot(int32_t index)
 {
-    return get_or_default_value(key, &default_value);
+    Slot *old = &oldItems[index];
+    *value_at(insert_index(&old->key, H::hash(old->key))) = *old_value_at(index);
+    old->occupied = false;
 }
 
-template<typename K, typename V>
-bool HashTable<K, V>::remove(K *key)
+template<typename K, typename V, typename H, bool S>
+void HashTable<K, V, H, S>::erase_old_index(int32_t index)
 {
-    int32_t hash = compute_hash(*key);
+    // Shifting is not possible across the moved part, so instead the rest of
+    // the chain is moved over now and cleared along with the erased item
+    int32_t mask = oldCapacity - 1;
+    oldItems[index].occupied = false;
 
-    for (int32_t i=hash; i<items.size + hash; ++i)
+    int32_t i = (index + 1) & mask;
+    for (int32_t n=0; n<oldCapacity; ++n, i=(i + 1) & mask)
     {
-        Item<K, V> *item = &items.data[i % items.size];
-        if (!item->occupied)
+        if (i < migrated)
         {
-            return false;
+            n += migrated - i - 1;
+            i = migrated - 1;
+            continue;
         }
-        else if (*key == item->key)
+        if (!oldItems[i].occupied)
         {
-            item->occupied = false;
-            return true;
+            break;
         }
+        move_old_slot(i);
     }
-    return false;
 }
 
-template<typename K, typename V>
-int32_t HashTable<K, V>::compute_hash(K key)
+template<typename K, typename V, typename H, bool S>
+void HashTable<K, V, H, S>::migrate(int32_t nSlots)
 {
-    uint32_t hash = hash_bytes((uint8_t *) &key, sizeof(K));
-    return (int32_t) (hash % capacity);
+    int32_t end = min_i(migrated + nSlots, oldCapacity);
+    for (; migrated<end; ++migrated)
+    {
+        if (oldItems[migrated].occupied)
+        {
+            move_old_slot(migrated);
+        }
+    }
+
+    if (migrated == oldCapacity)
+    {
+        free_old_items();
+    }
 }
 
-template<typename K, typename V>
-int32_t HashTable<K, V>::double_capacity()
+template<typename K, typename V, typename H, bool S>
+void HashTable<K, V, H, S>::free_old_items()
 {
-    printf("Hash table double capacity\n");
-    int32_t oldCapacity = capacity;
-    Item<K, V> *oldItems = items.data;
-
-    capacity *= 2;
-    init_dynamic_array<Item<K, V>>(&items, capacity, false, arena);
-    reset_hash_table(this);
-
-    // Recompute hashes
-    for (int32_t i=0; i<oldCapacity; ++i)
+    if (oldItems != NULL)
     {
-        Item<K, V> *item = &oldItems[i];
-        if (item->occupied)
+        if (S)
         {
-            set_value(item->key, item->value);
+            arena_free(arena, oldValues);
         }
+        arena_free(arena, oldItems);
+    }
+    oldItems = NULL;
+    oldValues = NULL;
+    oldCapacity = 0;
+    migrated = 0;
+}
+
+template<typename K, typename V, typename H, bool S>
+int32_t HashTable<K, V, H, S>::compute_hash(K key)
+{
+    return (int32_t) (H::hash(key) & uint32_t(capacity - 1));
+}
+
+template<typename K, typename V, typename H, bool S>
+int32_t HashTable<K, V, H, S>::double_capacity()
+{
+    if (migrating())
+    {
+        // Only happens with heavy inserts during a resize, finish it first
+        migrate(oldCapacity);
     }
 
-    arena_free(arena, oldItems);
+    int32_t nItems = nOccupied;
+    Slot *previousItems = items.data;
+    V *previousValues = values;
+    int32_t previousCapacity = capacity;
+
+    capacity *= 2;
+    if (arena == NULL)
+    {
+        // calloc hands out zeroed pages lazily, so there is no clearing pass
+        // over the new items that would stall this one operation
+        Slot *newItems = (Slot *) calloc(capacity, sizeof(Slot));
+        SDL_assert(newItems != NULL);
+        init_dynamic_array_from(&items, capacity, newItems, false, arena);
+        items.size = capacity;
+    }
+    else
+    {
+        init_dynamic_array<Slot>(&items, capacity, false, arena);
+        reset_hash_table(this);
+    }
+    if (S)
+    {
+        values = (V *) arena_alloc(arena, capacity*sizeof(V));
+        SDL_assert(values != NULL);
+    }
+    nOccupied = nItems;
+
+    oldItems = previousItems;
+    oldValues = previousValues;
+    oldCapacity = previousCapacity;
+    migrated = 0;
+    if (!incremental)
+    {
+        migrate(oldCapacity);
+    }
     return capacity;
 }
 
-#endif //HASH_TABLE_H
\ No newline at end of file
+#endif //HASH_TABLE_H
@@ -0,0 +1,117 @@
+#ifndef HASHER_H
+#define HASHER_H
+
+#include "stdint.h"
+#include "string.h"
+#include <type_traits>
+
+#include "glm/glm.hpp"
+
+// Hashers for the hash containers, selected by their H template parameter.
+// Hasher<K>::hash(key) returns 32 well-mixed bits, the containers mask the
+// low bits. The default hashes the raw bytes of the key, so keys with padding
+// bytes are rejected at compile time and need their own specialisation.
+
+static inline uint64_t hash_mix_64(uint64_t x)
+{
+    // Murmur3 finalizer
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+static inline uint32_t hash_u64(uint64_t x)
+{
+    return (uint32_t) hash_mix_64(x);
+}
+
+// Eight bytes per step, unlike hash_bytes
+static inline uint32_t hash_bytes_fast(const void *buffer, size_t length)
+{
+    const uint8_t *bytes = (const uint8_t *) buffer;
+    uint64_t hash = 0x9e3779b97f4a7c15ull ^ length;
+
+    while (length >= 8)
+    {
+        uint64_t word;
+        memcpy(&word, bytes, 8);
+        hash = (hash ^ word)*0xbf58476d1ce4e5b9ull;
+        hash ^= hash >> 29;
+        bytes += 8;
+        length -= 8;
+    }
+    if (length > 0)
+    {
+        uint64_t word = 0;
+        memcpy(&word, bytes, length);
+        hash = (hash ^ word)*0xbf58476d1ce4e5b9ull;
+    }
+    return hash_u64(hash);
+}
+
+template<typename K, typename Enable=void>
+struct Hasher
+{
+    static_assert(std::has_unique_object_representations<K>::value || std::is_floating_point<K>::value,
+                  "Specialise Hasher for keys with padding, their raw bytes differ between equal keys");
+
+    static uint32_t hash(const K &key)
+    {
+        return hash_bytes_fast(&key, sizeof(K));
+    }
+};
+
+template<typename K>
+struct Hasher<K, typename std::enable_if<std::is_integral<K>::value || std::is_enum<K>::value || std::is_pointer<K>::value>::type>
+{
+    static uint32_t hash(const K &key)
+    {
+        return hash_u64((uint64_t) key);
+    }
+};
+
+// Component-wise, 32-bit components are packed in pairs. Wider components
+// (dvec, i64vec) are hashed as raw bytes.
+template<glm::length_t L, typename T, glm::qualifier Q>
+struct Hasher<glm::vec<L, T, Q>>
+{
+    static uint32_t hash(const glm::vec<L, T, Q> &key)
+    {
+        if constexpr (sizeof(T) > 4)
+        {
+            return hash_bytes_fast(&key, sizeof(key));
+        }
+        else
+        {
+            uint64_t hash = 0x9e3779b97f4a7c15ull;
+            for (glm::length_t i=0; i<L; i+=2)
+            {
+                uint32_t low = 0;
+                uint32_t high = 0;
+                memcpy(&low, &key[i], sizeof(T));
+                if (i + 1 < L)
+                {
+                    memcpy(&high, &key[i + 1], sizeof(T));
+                }
+                hash = (hash ^ (uint64_t(high) << 32 | low))*0xbf58476d1ce4e5b9ull;
+                hash ^= hash >> 29;
+            }
+            return hash_u64(hash);
+        }
+    }
+};
+
+static inline int32_t round_up_power_of_two(int32_t x)
+{
+    int32_t result = 1;
+    while (result < x)
+    {
+        result *= 2;
+    }
+    return result;
+}
+
+#endif //HASHER_H
@@ -9,6 +9,7 @@
 #include "SDL_assert.h"
 
 #include "dynamic_array.h"
+#include "virtual_memory.h"
 
 #define DEFAULT_ALIGNMENT 2*sizeof(void *)
 
@@ -41,16 +42,29 @@ struct Arena
 	int nAllocations;
 	int nFrees;
 	size_t capacity;
+	bool pageBacked;
+	bool largePages;
 	DynamicArray<size_t> offsets;
 };
 
-static void init_arena(Arena *arena, int capacity)
+// pageBacked arenas map their memory from the OS and try 2 MB pages,
+// worth it for big arenas to cut TLB misses
+static void init_arena(Arena *arena, int capacity, bool pageBacked=false)
 {
-	printf("Init Arena with %d bytes\n", capacity);
     arena->capacity = capacity;
 	arena->nAllocations = 0;
 	arena->nFrees = 0;
-    arena->data = (char *) calloc(capacity, 1);
+	arena->pageBacked = pageBacked;
+	arena->largePages = false;
+	if (pageBacked)
+	{
+		arena->data = (char *) vm_alloc_large(capacity, &arena->largePages);
+	}
+	else
+	{
+		arena->data = (char *) calloc(capacity, 1);
+	}
+	printf("Init Arena with %d bytes%s\n", capacity, arena->largePages ? " (large pages)" : "");
 	SDL_assert(arena->data != NULL);
 	init_dynamic_array(&arena->offsets, 1024, true);
 	arena->offsets.append(size_t(0));
@@ -73,7 +87,14 @@ static void delete_arena(Arena *arena)
 {
 	free_arena(arena);
 	delete_dynamic_array(&arena->offsets);
-    free(arena->data);
+	if (arena->pageBacked)
+	{
+		vm_free_large(arena->data, arena->capacity);
+	}
+	else
+	{
+		free(arena->data);
+	}
 }
 
 static void *arena_alloc(Arena *arena, size_t size, size_t alignment)
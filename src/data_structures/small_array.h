@@ -0,0 +1,306 @@
+#ifndef SMALL_ARRAY_H
+#define SMALL_ARRAY_H
+
+#include "stdlib.h"
+#include "stdio.h"
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "SDL_assert.h"
+
+#include "../common.h"
+
+struct Arena;
+
+static void *arena_alloc(Arena *arena, size_t size);
+
+// Dynamic array for element types with constructors and destructors, like
+// Mesh-style structs that own memory. Elements are constructed on append,
+// moved when the array grows or shifts and destroyed on remove. Trivially
+// copyable types keep the memcpy/realloc paths of DynamicArray.
+//
+// The first N elements are stored inline, no allocation happens until the
+// array outgrows them. Access elements through operator[] or get_data(),
+// the data moves to the heap on growth. Copy arrays with copy_small_array.
+template<typename T, int32_t N>
+struct SmallArray
+{
+    static_assert(N > 0, "SmallArray needs an inline capacity");
+    static const bool trivial = std::is_trivially_copyable<T>::value;
+
+    int32_t size;
+    int32_t capacity;
+    Arena *arena;
+    T *heap;
+    alignas(T) unsigned char buffer[N*sizeof(T)];
+
+    T& operator[](int32_t id);
+    const T& operator[](int32_t id) const;
+
+    T *get_data();
+    const T *get_data() const;
+    bool is_inline();
+    int32_t reserve(int32_t newCapacity);
+    int32_t append(T *element);
+    int32_t append(T element);
+    T *get_slot();
+    T *insert_slot(int32_t index);
+    int32_t insert(T *element, int32_t index);
+    int32_t remove(int32_t index);
+    int32_t remove(int32_t index, int32_t n);
+    void swap(int32_t index1, int32_t index2);
+    int32_t double_capacity();
+};
+
+// Moves n elements into uninitialized memory at dest and destroys the
+// sources. dest must not overlap the end of src.
+template<typename T>
+static void relocate_elements(T *dest, T *src, int32_t n)
+{
+    if (std::is_trivially_copyable<T>::value)
+    {
+        std::memmove((void *) dest, (void *) src, n*sizeof(T));
+        return;
+    }
+    for (int32_t i=0; i<n; ++i)
+    {
+        new (&dest[i]) T(std::move(src[i]));
+        src[i].~T();
+    }
+}
+
+template<typename T, int32_t N>
+void init_small_array(SmallArray<T, N> *array, Arena *arena=NULL)
+{
+    array->size = 0;
+    array->capacity = N;
+    array->arena = arena;
+    array->heap = NULL;
+}
+
+template<typename T, int32_t N>
+void reset_small_array(SmallArray<T, N> *array)
+{
+    T *data = array->get_data();
+    for (int32_t i=0; i<array->size; ++i)
+    {
+        data[i].~T();
+    }
+    array->size = 0;
+}
+
+template<typename T, int32_t N>
+void delete_small_array(SmallArray<T, N> *array)
+{
+    reset_small_array(array);
+    if (array->heap != NULL)
+    {
+        arena_free(array->arena, array->heap);
+    }
+    array->heap = NULL;
+    array->capacity = N;
+}
+
+template<typename T, int32_t N>
+void copy_small_array(SmallArray<T, N> *destArray, SmallArray<T, N> *srcArray)
+{
+    init_small_array(destArray, srcArray->arena);
+    destArray->reserve(srcArray->size);
+    T *dest = destArray->get_data();
+    T *src = srcArray->get_data();
+    for (int32_t i=0; i<srcArray->size; ++i)
+    {
+        new (&dest[i]) T(src[i]);
+    }
+    destArray->size = srcArray->size;
+}
+
+// Takes over the elements of srcArray, which is left empty
+template<typename T, int32_t N>
+void move_small_array(SmallArray<T, N> *destArray, SmallArray<T, N> *srcArray)
+{
+    init_small_array(destArray, srcArray->arena);
+    if (srcArray->is_inline())
+    {
+        relocate_elements(destArray->get_data(), srcArray->get_data(), srcArray->size);
+    }
+    else
+    {
+        destArray->heap = srcArray->heap;
+        destArray->capacity = srcArray->capacity;
+    }
+    destArray->size = srcArray->size;
+    init_small_array(srcArray, srcArray->arena);
+}
+
+template<typename T, int32_t N>
+T& SmallArray<T, N>::operator[](int32_t id)
+{
+    SDL_assert(id >= 0 && id < size);
+    return get_data()[id];
+}
+
+template<typename T, int32_t N>
+const T& SmallArray<T, N>::operator[](int32_t id) const
+{
+    SDL_assert(id >= 0 && id < size);
+    return get_data()[id];
+}
+
+template<typename T, int32_t N>
+T *SmallArray<T, N>::get_data()
+{
+    return heap != NULL ? heap : (T *) buffer;
+}
+
+template<typename T, int32_t N>
+const T *SmallArray<T, N>::get_data() const
+{
+    return heap != NULL ? heap : (const T *) buffer;
+}
+
+template<typename T, int32_t N>
+bool SmallArray<T, N>::is_inline()
+{
+    return heap == NULL;
+}
+
+template<typename T, int32_t N>
+int32_t SmallArray<T, N>::reserve(int32_t newCapacity)
+{
+    if (newCapacity <= capacity)
+    {
+        return capacity;
+    }
+
+    T *newData;
+    if (trivial && heap != NULL)
+    {
+        newData = (T *) arena_realloc(arena, heap, capacity*sizeof(T), newCapacity*sizeof(T));
+    }
+    else
+    {
+        newData = (T *) arena_alloc(arena, newCapacity*sizeof(T));
+        if (newData != NULL)
+        {
+            relocate_elements(newData, get_data(), size);
+            if (heap != NULL)
+            {
+                arena_free(arena, heap);
+            }
+        }
+    }
+    if (newData == NULL)
+    {
+        printf("[ERROR] Could not allocate %d*%zd bytes of memory\n", newCapacity, sizeof(T));
+        SDL_assert(false);
+        return capacity;
+    }
+
+    heap = newData;
+    capacity = newCapacity;
+    return capacity;
+}
+
+template<typename T, int32_t N>
+int32_t SmallArray<T, N>::double_capacity()
+{
+    return reserve(2*capacity);
+}
+
+template<typename T, int32_t N>
+int32_t SmallArray<T, N>::append(T *element)
+{
+    // Copied first, element may point into this array
+    return append(T(*element));
+}
+
+template<typename T, int32_t N>
+int32_t SmallArray<T, N>::append(T element)
+{
+    if (!(size < capacity))
+    {
+        double_capacity();
+    }
+    new (&get_data()[size]) T(std::move(element));
+    return ++size;
+}
+
+template<typename T, int32_t N>
+T *SmallArray<T, N>::get_slot()
+{
+    if (!(size < capacity))
+    {
+        double_capacity();
+    }
+    T *slot = new (&get_data()[size]) T();
+    ++size;
+    return slot;
+}
+
+template<typename T, int32_t N>
+T *SmallArray<T, N>::insert_slot(int32_t index)
+{
+    SDL_assert(index >= 0 && index <= size);
+    if (!(size < capacity))
+    {
+        double_capacity();
+    }
+
+    T *data = get_data();
+    if (trivial)
+    {
+        std::memmove((void *) &data[index + 1], (void *) &data[index], (size - index)*sizeof(T));
+    }
+    else
+    {
+        // Back to front, each element moves into the slot freed before it
+        for (int32_t i=size; i>index; --i)
+        {
+            new (&data[i]) T(std::move(data[i - 1]));
+            data[i - 1].~T();
+        }
+    }
+    ++size;
+    return new (&data[index]) T();
+}
+
+template<typename T, int32_t N>
+int32_t SmallArray<T, N>::insert(T *element, int32_t index)
+{
+    T value(*element);
+    *insert_slot(index) = std::move(value);
+    return size;
+}
+
+template<typename T, int32_t N>
+int32_t SmallArray<T, N>::remove(int32_t index)
+{
+    return remove(index, 1);
+}
+
+template<typename T, int32_t N>
+int32_t SmallArray<T, N>::remove(int32_t index, int32_t n)
+{
+    SDL_assert(index >= 0 && index + n <= size);
+    T *data = get_data();
+    for (int32_t i=index; i<index + n; ++i)
+    {
+        data[i].~T();
+    }
+    relocate_elements(&data[index], &data[index + n], size - index - n);
+    return size -= n;
+}
+
+template<typename T, int32_t N>
+void SmallArray<T, N>::swap(int32_t index1, int32_t index2)
+{
+    T *data = get_data();
+    T temp = std::move(data[index1]);
+    data[index1] = std::move(data[index2]);
+    data[index2] = std::move(temp);
+}
+
+#endif //SMALL_ARRAY_H
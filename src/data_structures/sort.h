@@ -0,0 +1,209 @@
+#ifndef SORT_H
+#define SORT_H
+
+#include "stdlib.h"
+#include "stdint.h"
+#include <cstring>
+#include <utility>
+
+#include "SDL_assert.h"
+
+struct Arena;
+
+static void *arena_alloc(Arena *arena, size_t size);
+
+// Ranges up to this size are finished by insertion sort
+#define SORT_INSERTION_THRESHOLD 16
+
+// Sorting templates for DynamicArray and plain arrays. The comparator is a
+// template parameter, so unlike qsort it gets inlined.
+
+template<typename T, typename Less>
+static void insertion_sort(T *data, int32_t n, Less less)
+{
+    for (int32_t i=1; i<n; ++i)
+    {
+        T value = std::move(data[i]);
+        int32_t j = i;
+        for (; j>0 && less(value, data[j - 1]); --j)
+        {
+            data[j] = std::move(data[j - 1]);
+        }
+        data[j] = std::move(value);
+    }
+}
+
+template<typename T, typename Less>
+static void sift_down(T *data, int32_t root, int32_t n, Less less)
+{
+    T value = std::move(data[root]);
+    while (2*root + 1 < n)
+    {
+        int32_t child = 2*root + 1;
+        if (child + 1 < n && less(data[child], data[child + 1]))
+        {
+            ++child;
+        }
+        if (!less(value, data[child]))
+        {
+            break;
+        }
+        data[root] = std::move(data[child]);
+        root = child;
+    }
+    data[root] = std::move(value);
+}
+
+template<typename T, typename Less>
+static void heap_sort(T *data, int32_t n, Less less)
+{
+    for (int32_t i=n/2 - 1; i>=0; --i)
+    {
+        sift_down(data, i, n, less);
+    }
+    for (int32_t i=n - 1; i>0; --i)
+    {
+        std::swap(data[0], data[i]);
+        sift_down(data, 0, i, less);
+    }
+}
+
+template<typename T, typename Less>
+static void introsort_loop(T *data, int32_t n, int32_t depth, Less less)
+{
+    while (n > SORT_INSERTION_THRESHOLD)
+    {
+        if (depth == 0)
+        {
+            // Bad pivots keep coming, bound the worst case to n log n
+            heap_sort(data, n, less);
+            return;
+        }
+        --depth;
+
+        // Median of three to data[0], also a sentinel for both scans
+        int32_t mid = n/2;
+        if (less(data[mid], data[0])) std::swap(data[mid], data[0]);
+        if (less(data[n - 1], data[0])) std::swap(data[n - 1], data[0]);
+        if (less(data[n - 1], data[mid])) std::swap(data[n - 1], data[mid]);
+        std::swap(data[0], data[mid]);
+
+        // Hoare partition around data[0]
+        int32_t i = 0;
+        int32_t j = n;
+        while (true)
+        {
+            do { ++i; } while (i < n && less(data[i], data[0]));
+            do { --j; } while (less(data[0], data[j]));
+            if (i >= j)
+            {
+                break;
+            }
+            std::swap(data[i], data[j]);
+        }
+        std::swap(data[0], data[j]);
+
+        // Recurse into the smaller side, loop on the larger one
+        if (j < n - j - 1)
+        {
+            introsort_loop(data, j, depth, less);
+            data += j + 1;
+            n -= j + 1;
+        }
+        else
+        {
+            introsort_loop(data + j + 1, n - j - 1, depth, less);
+            n = j;
+        }
+    }
+    insertion_sort(data, n, less);
+}
+
+// Unstable, O(n log n) worst case
+template<typename T, typename Less>
+static void introsort(T *data, int32_t n, Less less)
+{
+    int32_t depth = 0;
+    for (int32_t i=n; i>1; i/=2)
+    {
+        depth += 2;
+    }
+    introsort_loop(data, n, depth, less);
+}
+
+// Radix keys map a value to an unsigned integer with the same order
+static inline uint32_t radix_key(uint32_t x) { return x; }
+static inline uint64_t radix_key(uint64_t x) { return x; }
+static inline uint32_t radix_key(int32_t x) { return uint32_t(x) ^ 0x80000000u; }
+static inline uint64_t radix_key(int64_t x) { return uint64_t(x) ^ 0x8000000000000000ull; }
+
+static inline uint32_t radix_key(float x)
+{
+    // Negative floats sort reversed, so flip all their bits
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+// Stable LSD radix sort, one pass per key byte. key(element) returns one of
+// the types radix_key() takes. Needs a scratch copy of the array, from arena.
+// Passes where all keys share the byte are skipped.
+template<typename T, typename F>
+static void radix_sort(T *data, int32_t n, F key, Arena *arena=NULL)
+{
+    typedef decltype(radix_key(key(data[0]))) Key;
+    const int32_t nPasses = int32_t(sizeof(Key));
+    if (n < 2)
+    {
+        return;
+    }
+
+    T *scratch = (T *) arena_alloc(arena, n*sizeof(T));
+    SDL_assert(scratch != NULL);
+
+    // All histograms in one read over the data
+    int32_t counts[sizeof(Key)][256];
+    memset(counts, 0, sizeof(counts));
+    for (int32_t i=0; i<n; ++i)
+    {
+        Key k = radix_key(key(data[i]));
+        for (int32_t pass=0; pass<nPasses; ++pass)
+        {
+            ++counts[pass][(k >> (8*pass)) & 0xFF];
+        }
+    }
+
+    T *source = data;
+    T *dest = scratch;
+    for (int32_t pass=0; pass<nPasses; ++pass)
+    {
+        int32_t *count = counts[pass];
+        Key first = radix_key(key(source[0]));
+        if (count[(first >> (8*pass)) & 0xFF] == n)
+        {
+            continue;
+        }
+
+        int32_t offset = 0;
+        for (int32_t b=0; b<256; ++b)
+        {
+            int32_t c = count[b];
+            count[b] = offset;
+            offset += c;
+        }
+        for (int32_t i=0; i<n; ++i)
+        {
+            Key k = radix_key(key(source[i]));
+            dest[count[(k >> (8*pass)) & 0xFF]++] = source[i];
+        }
+        std::swap(source, dest);
+    }
+
+    if (source != data)
+    {
+        memcpy((void *) data, (void *) source, n*sizeof(T));
+    }
+    arena_free(arena, scratch);
+}
+
+#endif //SORT_H
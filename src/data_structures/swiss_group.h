@@ -0,0 +1,79 @@
+#ifndef SWISS_GROUP_H
+#define SWISS_GROUP_H
+
+#include "stdint.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SWISS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Control bytes shared by SwissTable and SwissSet. A full slot stores the low
+// 7 bits of its hash, empty and deleted slots have the high bit set.
+#define SWISS_GROUP_SIZE 16
+#define SWISS_EMPTY ((int8_t) -128)
+#define SWISS_DELETED ((int8_t) -2)
+
+static inline int swiss_first_bit(uint32_t mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int) index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// One bit per slot of the 16-slot group starting at controls
+static inline uint32_t swiss_match(const int8_t *controls, int8_t tag)
+{
+#ifdef SWISS_SSE2
+    __m128i group = _mm_loadu_si128((const __m128i *) controls);
+    return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(tag)));
+#else
+    uint32_t mask = 0;
+    for (int i=0; i<SWISS_GROUP_SIZE; ++i)
+    {
+        mask |= uint32_t(controls[i] == tag) << i;
+    }
+    return mask;
+#endif
+}
+
+static inline uint32_t swiss_match_empty(const int8_t *controls)
+{
+    return swiss_match(controls, SWISS_EMPTY);
+}
+
+// Empty or deleted, i.e. high bit set
+static inline uint32_t swiss_match_free(const int8_t *controls)
+{
+#ifdef SWISS_SSE2
+    return (uint32_t) _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) controls));
+#else
+    uint32_t mask = 0;
+    for (int i=0; i<SWISS_GROUP_SIZE; ++i)
+    {
+        mask |= uint32_t(controls[i] < 0) << i;
+    }
+    return mask;
+#endif
+}
+
+static inline int32_t swiss_round_capacity(int32_t capacity)
+{
+    // Whole number of groups, power of two so probing can mask
+    int32_t result = SWISS_GROUP_SIZE;
+    while (result < capacity)
+    {
+        result *= 2;
+    }
+    return result;
+}
+
+#endif //SWISS_GROUP_H
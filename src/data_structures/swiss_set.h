@@ -0,0 +1,235 @@
+#ifndef SWISS_SET_H
+#define SWISS_SET_H
+
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+
+#include "SDL_assert.h"
+
+#include "dynamic_array.h"
+#include "swiss_group.h"
+#include "hasher.h"
+#include "../common.h"
+
+// Swiss set: HashSet with the control-byte layout of SwissTable
+template<typename K, typename H=Hasher<K>>
+struct SwissSet
+{
+    int nElems;
+    int nDeleted;
+    int growthLeft;
+    int capacity;
+    Arena *arena;
+    DynamicArray<int8_t> controls;
+    DynamicArray<K> keys;
+
+    float load_factor();
+
+    bool contains(K *key);
+    bool contains(K key);
+    void add(K *key);
+    void add(K key);
+    bool remove(K *key);
+
+    uint32_t compute_hash(K key);
+    int find_index(K *key, uint32_t hash);
+    int find_free_index(uint32_t hash);
+    int prepare_insert(uint32_t hash);
+    int rehash(int newCapacity);
+};
+
+template<typename K, typename H>
+void reset_swiss_set(SwissSet<K, H> *set)
+{
+    set->nElems = 0;
+    set->nDeleted = 0;
+    set->growthLeft = set->capacity - set->capacity/8;
+    set->controls.size = set->capacity;
+    set->keys.size = set->capacity;
+    memset(set->controls.data, SWISS_EMPTY, set->capacity);
+}
+
+template<typename K, typename H>
+void init_swiss_set(SwissSet<K, H> *set, int capacity, Arena *arena=NULL)
+{
+    set->capacity = swiss_round_capacity(capacity);
+    set->arena = arena;
+    init_dynamic_array(&set->controls, set->capacity, false, arena);
+    init_dynamic_array(&set->keys, set->capacity, false, arena);
+    reset_swiss_set(set);
+}
+
+template<typename K, typename H>
+void delete_swiss_set(SwissSet<K, H> *set)
+{
+    set->capacity = 0;
+    delete_dynamic_array(&set->keys);
+    delete_dynamic_array(&set->controls);
+}
+
+template<typename K, typename H>
+float SwissSet<K, H>::load_factor()
+{
+    return float(nElems)/float(capacity);
+}
+
+template<typename K, typename H>
+uint32_t SwissSet<K, H>::compute_hash(K key)
+{
+    return H::hash(key);
+}
+
+template<typename K, typename H>
+int SwissSet<K, H>::find_index(K *key, uint32_t hash)
+{
+    int8_t tag = int8_t(hash & 0x7F);
+    int groupMask = capacity/SWISS_GROUP_SIZE - 1;
+    int group = int(hash >> 7) & groupMask;
+
+    for (int step=1; ; ++step)
+    {
+        int first = group*SWISS_GROUP_SIZE;
+        uint32_t match = swiss_match(&controls.data[first], tag);
+        while (match != 0)
+        {
+            int index = first + swiss_first_bit(match);
+            if (*key == keys.data[index])
+            {
+                return index;
+            }
+            match &= match - 1;
+        }
+        if (swiss_match_empty(&controls.data[first]) != 0)
+        {
+            return -1;
+        }
+        group = (group + step) & groupMask;
+    }
+}
+
+template<typename K, typename H>
+int SwissSet<K, H>::find_free_index(uint32_t hash)
+{
+    int groupMask = capacity/SWISS_GROUP_SIZE - 1;
+    int group = int(hash >> 7) & groupMask;
+
+    for (int step=1; ; ++step)
+    {
+        int first = group*SWISS_GROUP_SIZE;
+        uint32_t match = swiss_match_free(&controls.data[first]);
+        if (match != 0)
+        {
+            return first + swiss_first_bit(match);
+        }
+        group = (group + step) & groupMask;
+    }
+}
+
+template<typename K, typename H>
+int SwissSet<K, H>::prepare_insert(uint32_t hash)
+{
+    int index = find_free_index(hash);
+    if (growthLeft == 0 && controls.data[index] != SWISS_DELETED)
+    {
+        rehash(nElems < capacity*7/16 ? capacity : 2*capacity);
+        index = find_free_index(hash);
+    }
+
+    if (controls.data[index] == SWISS_EMPTY)
+    {
+        --growthLeft;
+    }
+    else
+    {
+        --nDeleted;
+    }
+    controls.data[index] = int8_t(hash & 0x7F);
+    ++nElems;
+    return index;
+}
+
+template<typename K, typename H>
+bool SwissSet<K, H>::contains(K *key)
+{
+    return find_index(key, compute_hash(*key)) >= 0;
+}
+
+template<typename K, typename H>
+bool SwissSet<K, H>::contains(K key)
+{
+    return contains(&key);
+}
+
+template<typename K, typename H>
+void SwissSet<K, H>::add(K *key)
+{
+    uint32_t hash = compute_hash(*key);
+    if (find_index(key, hash) < 0)
+    {
+        int index = prepare_insert(hash);
+        keys.data[index] = *key;
+    }
+}
+
+template<typename K, typename H>
+void SwissSet<K, H>::add(K key)
+{
+    return add(&key);
+}
+
+template<typename K, typename H>
+bool SwissSet<K, H>::remove(K *key)
+{
+    int index = find_index(key, compute_hash(*key));
+    if (index < 0)
+    {
+        return false;
+    }
+
+    int first = index & ~(SWISS_GROUP_SIZE - 1);
+    if (swiss_match_empty(&controls.data[first]) != 0)
+    {
+        controls.data[index] = SWISS_EMPTY;
+        ++growthLeft;
+    }
+    else
+    {
+        controls.data[index] = SWISS_DELETED;
+        ++nDeleted;
+    }
+    --nElems;
+    return true;
+}
+
+template<typename K, typename H>
+int SwissSet<K, H>::rehash(int newCapacity)
+{
+    int oldCapacity = capacity;
+    int8_t *oldControls = controls.data;
+    K *oldKeys = keys.data;
+
+    capacity = newCapacity;
+    init_dynamic_array(&controls, capacity, false, arena);
+    init_dynamic_array(&keys, capacity, false, arena);
+    reset_swiss_set(this);
+
+    for (int i=0; i<oldCapacity; ++i)
+    {
+        if (oldControls[i] >= 0)
+        {
+            uint32_t hash = compute_hash(oldKeys[i]);
+            int index = find_free_index(hash);
+            controls.data[index] = int8_t(hash & 0x7F);
+            keys.data[index] = oldKeys[i];
+            ++nElems;
+            --growthLeft;
+        }
+    }
+
+    arena_free(arena, oldKeys);
+    arena_free(arena, oldControls);
+    return capacity;
+}
+
+#endif //SWISS_SET_H
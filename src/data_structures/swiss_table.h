@@ -0,0 +1,287 @@
+#ifndef SWISS_TABLE_H
+#define SWISS_TABLE_H
+
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+
+#include "SDL_assert.h"
+
+#include "dynamic_array.h"
+#include "swiss_group.h"
+#include "hasher.h"
+#include "../common.h"
+
+template<typename K, typename V>
+struct SwissItem
+{
+    K key;
+    V value;
+};
+
+// Swiss table: open addressing with a separate array of control bytes.
+// Probing compares the 7-bit hash tags of 16 slots at once and only touches
+// items on a tag match. Drop-in for HashTable, with a maximum load of 7/8.
+template<typename K, typename V, typename H=Hasher<K>>
+struct SwissTable
+{
+    int32_t nOccupied;
+    int32_t nDeleted;
+    int32_t growthLeft;
+    int32_t capacity;
+    Arena *arena;
+    DynamicArray<int8_t> controls;
+    DynamicArray<SwissItem<K, V>> items;
+
+    float load_factor();
+
+    V *get_value(K *key);
+    V get_value(K key);
+    V *set_value(K *key, V *value);
+    V *set_value(K *key, V value);
+    V *set_value(K key, V value);
+    V *get_or_default_value(K *key, V *default_value);
+    V *get_or_default_value(K *key, V default_value);
+    bool remove(K *key);
+
+    uint32_t compute_hash(K key);
+    int32_t find_index(K *key, uint32_t hash);
+    int32_t find_free_index(uint32_t hash);
+    int32_t prepare_insert(uint32_t hash);
+    int32_t rehash(int32_t newCapacity);
+};
+
+template<typename K, typename V, typename H>
+void reset_swiss_table(SwissTable<K, V, H> *table)
+{
+    table->nOccupied = 0;
+    table->nDeleted = 0;
+    table->growthLeft = table->capacity - table->capacity/8;
+    table->controls.size = table->capacity;
+    table->items.size = table->capacity;
+    memset(table->controls.data, SWISS_EMPTY, table->capacity);
+}
+
+template<typename K, typename V, typename H>
+void init_swiss_table(SwissTable<K, V, H> *table, int32_t capacity, Arena *arena=NULL)
+{
+    table->capacity = swiss_round_capacity(capacity);
+    table->arena = arena;
+    init_dynamic_array(&table->controls, table->capacity, false, arena);
+    init_dynamic_array(&table->items, table->capacity, false, arena);
+    reset_swiss_table(table);
+}
+
+template<typename K, typename V, typename H>
+void delete_swiss_table(SwissTable<K, V, H> *table)
+{
+    table->capacity = 0;
+    delete_dynamic_array(&table->items);
+    delete_dynamic_array(&table->controls);
+}
+
+template<typename K, typename V, typename H>
+float SwissTable<K, V, H>::load_factor()
+{
+    return float(nOccupied)/float(capacity);
+}
+
+template<typename K, typename V, typename H>
+uint32_t SwissTable<K, V, H>::compute_hash(K key)
+{
+    return H::hash(key);
+}
+
+template<typename K, typename V, typename H>
+int32_t SwissTable<K, V, H>::find_index(K *key, uint32_t hash)
+{
+    int8_t tag = int8_t(hash & 0x7F);
+    int32_t groupMask = capacity/SWISS_GROUP_SIZE - 1;
+    int32_t group = int32_t(hash >> 7) & groupMask;
+
+    // Triangular probing visits every group once
+    for (int32_t step=1; ; ++step)
+    {
+        int32_t first = group*SWISS_GROUP_SIZE;
+        uint32_t match = swiss_match(&controls.data[first], tag);
+        while (match != 0)
+        {
+            int32_t index = first + swiss_first_bit(match);
+            if (*key == items.data[index].key)
+            {
+                return index;
+            }
+            match &= match - 1;
+        }
+        if (swiss_match_empty(&controls.data[first]) != 0)
+        {
+            return -1;
+        }
+        group = (group + step) & groupMask;
+    }
+}
+
+template<typename K, typename V, typename H>
+int32_t SwissTable<K, V, H>::find_free_index(uint32_t hash)
+{
+    int32_t groupMask = capacity/SWISS_GROUP_SIZE - 1;
+    int32_t group = int32_t(hash >> 7) & groupMask;
+
+    for (int32_t step=1; ; ++step)
+    {
+        int32_t first = group*SWISS_GROUP_SIZE;
+        uint32_t match = swiss_match_free(&controls.data[first]);
+        if (match != 0)
+        {
+            return first + swiss_first_bit(match);
+        }
+        group = (group + step) & groupMask;
+    }
+}
+
+template<typename K, typename V, typename H>
+int32_t SwissTable<K, V, H>::prepare_insert(uint32_t hash)
+{
+    int32_t index = find_free_index(hash);
+    if (growthLeft == 0 && controls.data[index] != SWISS_DELETED)
+    {
+        // Mostly tombstones: clean up in place rather than grow
+        rehash(nOccupied < capacity*7/16 ? capacity : 2*capacity);
+        index = find_free_index(hash);
+    }
+
+    if (controls.data[index] == SWISS_EMPTY)
+    {
+        --growthLeft;
+    }
+    else
+    {
+        --nDeleted;
+    }
+    controls.data[index] = int8_t(hash & 0x7F);
+    ++nOccupied;
+    return index;
+}
+
+template<typename K, typename V, typename H>
+V *SwissTable<K, V, H>::get_value(K *key)
+{
+    int32_t index = find_index(key, compute_hash(*key));
+    return index < 0 ? NULL : &items.data[index].value;
+}
+
+template<typename K, typename V, typename H>
+V SwissTable<K, V, H>::get_value(K key)
+{
+    V *value = get_value(&key);
+    if (value == NULL)
+    {
+        printf("[ERROR] key not available\n");
+        SDL_assert(false);
+    }
+    return *value;
+}
+
+template<typename K, typename V, typename H>
+V *SwissTable<K, V, H>::set_value(K *key, V *value)
+{
+    uint32_t hash = compute_hash(*key);
+    int32_t index = find_index(key, hash);
+    if (index < 0)
+    {
+        index = prepare_insert(hash);
+        items.data[index].key = *key;
+    }
+    items.data[index].value = *value;
+    return &items.data[index].value;
+}
+
+template<typename K, typename V, typename H>
+V *SwissTable<K, V, H>::set_value(K key, V value)
+{
+    return set_value(&key, &value);
+}
+
+template<typename K, typename V, typename H>
+V *SwissTable<K, V, H>::set_value(K *key, V value)
+{
+    return set_value(key, &value);
+}
+
+template<typename K, typename V, typename H>
+V *SwissTable<K, V, H>::get_or_default_value(K *key, V *default_value)
+{
+    uint32_t hash = compute_hash(*key);
+    int32_t index = find_index(key, hash);
+    if (index < 0)
+    {
+        index = prepare_insert(hash);
+        items.data[index].key = *key;
+        items.data[index].value = *default_value;
+    }
+    return &items.data[index].value;
+}
+
+template<typename K, typename V, typename H>
+V *SwissTable<K, V, H>::get_or_default_value(K *key, V default_value)
+{
+    return get_or_default_value(key, &default_value);
+}
+
+template<typename K, typename V, typename H>
+bool SwissTable<K, V, H>::remove(K *key)
+{
+    int32_t index = find_index(key, compute_hash(*key));
+    if (index < 0)
+    {
+        return false;
+    }
+
+    // A group with an empty slot ends every probe that reaches it, so the
+    // slot can become empty again. Otherwise it must stay a tombstone.
+    int32_t first = index & ~(SWISS_GROUP_SIZE - 1);
+    if (swiss_match_empty(&controls.data[first]) != 0)
+    {
+        controls.data[index] = SWISS_EMPTY;
+        ++growthLeft;
+    }
+    else
+    {
+        controls.data[index] = SWISS_DELETED;
+        ++nDeleted;
+    }
+    --nOccupied;
+    return true;
+}
+
+template<typename K, typename V, typename H>
+int32_t SwissTable<K, V, H>::rehash(int32_t newCapacity)
+{
+    int32_t oldCapacity = capacity;
+    int8_t *oldControls = controls.data;
+    SwissItem<K, V> *oldItems = items.data;
+
+    capacity = newCapacity;
+    init_dynamic_array(&controls, capacity, false, arena);
+    init_dynamic_array(&items, capacity, false, arena);
+    reset_swiss_table(this);
+
+    for (int32_t i=0; i<oldCapacity; ++i)
+    {
+        if (oldControls[i] >= 0)
+        {
+            uint32_t hash = compute_hash(oldItems[i].key);
+            int32_t index = find_free_index(hash);
+            controls.data[index] = int8_t(hash & 0x7F);
+            items.data[index] = oldItems[i];
+            ++nOccupied;
+            --growthLeft;
+        }
+    }
+
+    arena_free(arena, oldItems);
+    arena_free(arena, oldControls);
+    return capacity;
+}
+
+#endif //SWISS_TABLE_H
@@ -0,0 +1,184 @@
+#ifndef VIRTUAL_ARRAY_H
+#define VIRTUAL_ARRAY_H
+
+#include "stdlib.h"
+#include "stdio.h"
+#include "stdint.h"
+#include <cstring>
+
+#include "SDL_assert.h"
+
+#include "virtual_memory.h"
+#include "../common.h"
+
+// Address space reserved when no maximum is given
+#define VIRTUAL_ARRAY_DEFAULT_RESERVE (int64_t(64)*1024*1024*1024)
+// Smallest step by which committed memory grows
+#define VIRTUAL_ARRAY_MIN_COMMIT (int64_t(64)*1024)
+// Largest step on Windows, where committed memory is charged right away
+#define VIRTUAL_ARRAY_MAX_COMMIT_STEP (int64_t(64)*1024*1024)
+
+// Array for large data, e.g. meshes and datasets. The whole maximum range of
+// addresses is reserved up front and pages are committed as it grows, so
+// growing never copies and pointers into it stay valid. Sizes are 64-bit.
+// Elements are not constructed, like DynamicArray only for plain types.
+template<typename T>
+struct VirtualArray
+{
+    int64_t size;
+    int64_t capacity;
+    int64_t maxCapacity;
+    T *data;
+
+    T& operator[](int64_t id);
+    const T& operator[](int64_t id) const;
+
+    int64_t reserve(int64_t newCapacity);
+    int64_t append(T *element, int64_t n=1);
+    int64_t append(T element);
+    T *get_slot();
+    int64_t remove(int64_t index);
+    int64_t set_to(T value);
+};
+
+template<typename T>
+void init_virtual_array(VirtualArray<T> *array, int64_t maxCapacity=-1)
+{
+    if (maxCapacity < 0)
+    {
+        maxCapacity = VIRTUAL_ARRAY_DEFAULT_RESERVE/int64_t(sizeof(T));
+    }
+    array->size = 0;
+    array->capacity = 0;
+    array->maxCapacity = maxCapacity;
+    array->data = (T *) vm_reserve(vm_round_to_page(maxCapacity*sizeof(T)));
+
+    if (array->data == NULL)
+    {
+        printf("[ERROR] Could not reserve %lld*%zd bytes of address space\n", (long long) maxCapacity, sizeof(T));
+        SDL_assert(false);
+    }
+}
+
+template<typename T>
+void delete_virtual_array(VirtualArray<T> *array)
+{
+    vm_release(array->data, vm_round_to_page(array->maxCapacity*sizeof(T)));
+    array->data = NULL;
+    array->size = 0;
+    array->capacity = 0;
+    array->maxCapacity = 0;
+}
+
+template<typename T>
+void reset_virtual_array(VirtualArray<T> *array)
+{
+    // Keeps the committed pages for reuse
+    array->size = 0;
+}
+
+template<typename T>
+T& VirtualArray<T>::operator[](int64_t id)
+{
+    SDL_assert(id >= 0 && id < size);
+    return data[id];
+}
+
+template<typename T>
+const T& VirtualArray<T>::operator[](int64_t id) const
+{
+    SDL_assert(id >= 0 && id < size);
+    return data[id];
+}
+
+template<typename T>
+int64_t VirtualArray<T>::reserve(int64_t newCapacity)
+{
+    if (newCapacity <= capacity)
+    {
+        return capacity;
+    }
+    if (newCapacity > maxCapacity)
+    {
+        printf("[ERROR] Virtual array capacity %lld exceeds its reserved %lld elements\n", (long long) newCapacity, (long long) maxCapacity);
+        SDL_assert(false);
+        return capacity;
+    }
+
+    // Commit at least as much again as is committed already, so the number
+    // of commit calls stays logarithmic. On Linux untouched committed pages
+    // cost nothing. Windows charges MEM_COMMIT against the commit limit at
+    // once, so there the step is capped to bound the overcommit.
+    int64_t committed = int64_t(vm_round_to_page(capacity*sizeof(T)));
+    int64_t reserved = int64_t(vm_round_to_page(maxCapacity*sizeof(T)));
+    int64_t wanted = newCapacity*int64_t(sizeof(T));
+#ifdef _WIN32
+    wanted = max_i(wanted, committed + min_i(committed, VIRTUAL_ARRAY_MAX_COMMIT_STEP));
+#else
+    wanted = max_i(wanted, 2*committed);
+#endif
+    wanted = max_i(wanted, VIRTUAL_ARRAY_MIN_COMMIT);
+    wanted = min_i(int64_t(vm_round_to_page(wanted)), reserved);
+
+    if (!vm_commit((char *) data + committed, size_t(wanted - committed)))
+    {
+        printf("[ERROR] Could not commit %lld bytes of memory\n", (long long) (wanted - committed));
+        SDL_assert(false);
+        return capacity;
+    }
+    capacity = min_i(wanted/int64_t(sizeof(T)), maxCapacity);
+    return capacity;
+}
+
+template<typename T>
+int64_t VirtualArray<T>::append(T *element, int64_t n)
+{
+    if (size + n > capacity)
+    {
+        reserve(size + n);
+    }
+    std::memcpy(&data[size], element, n*sizeof(T));
+    size += n;
+    return size;
+}
+
+template<typename T>
+int64_t VirtualArray<T>::append(T element)
+{
+    if (!(size < capacity))
+    {
+        reserve(size + 1);
+    }
+    data[size] = element;
+    return ++size;
+}
+
+template<typename T>
+T *VirtualArray<T>::get_slot()
+{
+    if (!(size < capacity))
+    {
+        reserve(size + 1);
+    }
+    ++size;
+    return &data[size-1];
+}
+
+template<typename T>
+int64_t VirtualArray<T>::remove(int64_t index)
+{
+    std::memmove(&data[index], &data[index+1], (size - index - 1)*sizeof(T));
+    return --size;
+}
+
+template<typename T>
+int64_t VirtualArray<T>::set_to(T value)
+{
+    for (int64_t i=0; i<size; ++i)
+    {
+        data[i] = value;
+    }
+    return size;
+}
+
+#endif //VIRTUAL_ARRAY_H
@@ -0,0 +1,193 @@
+#ifndef VIRTUAL_MEMORY_H
+#define VIRTUAL_MEMORY_H
+
+#include "stdlib.h"
+#include "stdio.h"
+#include "stdint.h"
+
+#include "SDL_assert.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "advapi32.lib")
+#endif
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#define LARGE_PAGE_SIZE (size_t(2)*1024*1024)
+
+// Page-granular allocations straight from the OS, for big long-lived tables.
+// Memory comes back zeroed and must be released with vm_free_large().
+
+static size_t vm_round_to_large_page(size_t size)
+{
+    return (size + LARGE_PAGE_SIZE - 1) & ~(LARGE_PAGE_SIZE - 1);
+}
+
+#ifdef _WIN32
+// MEM_LARGE_PAGES fails unless SeLockMemoryPrivilege is enabled in the
+// process token, holding it is not enough. Tried once per process.
+static bool vm_enable_lock_memory_privilege()
+{
+    static bool tried = false;
+    static bool enabled = false;
+    if (tried)
+    {
+        return enabled;
+    }
+    tried = true;
+
+    HANDLE token;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+    {
+        return false;
+    }
+
+    TOKEN_PRIVILEGES privileges = {};
+    privileges.PrivilegeCount = 1;
+    privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    if (LookupPrivilegeValue(NULL, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid))
+    {
+        // Succeeds without enabling anything if the account lacks the
+        // privilege, that case is reported as ERROR_NOT_ALL_ASSIGNED
+        AdjustTokenPrivileges(token, FALSE, &privileges, 0, NULL, NULL);
+        enabled = GetLastError() == ERROR_SUCCESS;
+    }
+    CloseHandle(token);
+    return enabled;
+}
+#endif
+
+// Tries explicit 2 MB pages first, then falls back to normal pages
+// (transparent huge pages on Linux). Sets *largePages on the first path.
+static void *vm_alloc_large(size_t size, bool *largePages)
+{
+    *largePages = false;
+    size = vm_round_to_large_page(size);
+
+#ifdef _WIN32
+    // The account must be granted "Lock pages in memory" (usually it is
+    // not) and the privilege must be enabled in the token
+    size_t minimum = GetLargePageMinimum();
+    if (minimum > 0 && size % minimum == 0 && vm_enable_lock_memory_privilege())
+    {
+        void *data = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (data != NULL)
+        {
+            *largePages = true;
+            return data;
+        }
+    }
+    return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+#ifdef MAP_HUGETLB
+    // Only succeeds if huge pages were reserved, e.g. vm.nr_hugepages
+    void *huge = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (huge != MAP_FAILED)
+    {
+        *largePages = true;
+        return huge;
+    }
+#endif
+
+    // Over-map so the region can be trimmed to 2 MB alignment, which the
+    // kernel needs to back it with transparent huge pages
+    size_t mapped = size + LARGE_PAGE_SIZE;
+    char *raw = (char *) mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED)
+    {
+        return NULL;
+    }
+    char *data = (char *) ((uintptr_t(raw) + LARGE_PAGE_SIZE - 1) & ~uintptr_t(LARGE_PAGE_SIZE - 1));
+    size_t head = size_t(data - raw);
+    if (head > 0)
+    {
+        munmap(raw, head);
+    }
+    munmap(data + size, mapped - head - size);
+
+#ifdef MADV_HUGEPAGE
+    madvise(data, size, MADV_HUGEPAGE);
+#endif
+    return data;
+#endif
+}
+
+static void vm_free_large(void *data, size_t size)
+{
+    if (data == NULL)
+    {
+        return;
+    }
+#ifdef _WIN32
+    (void) size;
+    VirtualFree(data, 0, MEM_RELEASE);
+#else
+    munmap(data, vm_round_to_large_page(size));
+#endif
+}
+
+// Reserve/commit pairs for arrays that grow in place. A reserved range only
+// takes address space, pages count as memory once committed and touched.
+
+static size_t vm_page_size()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return size_t(info.dwPageSize);
+#else
+    return size_t(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+static size_t vm_round_to_page(size_t size)
+{
+    size_t pageSize = vm_page_size();
+    return (size + pageSize - 1)/pageSize*pageSize;
+}
+
+static void *vm_reserve(size_t size)
+{
+#ifdef _WIN32
+    return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+    void *data = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return data == MAP_FAILED ? NULL : data;
+#endif
+}
+
+// Makes [data, data + size) of a reserved range usable, data page aligned
+static bool vm_commit(void *data, size_t size)
+{
+#ifdef _WIN32
+    return VirtualAlloc(data, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+#else
+    return mprotect(data, size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+static void vm_release(void *data, size_t size)
+{
+    if (data == NULL)
+    {
+        return;
+    }
+#ifdef _WIN32
+    (void) size;
+    VirtualFree(data, 0, MEM_RELEASE);
+#else
+    munmap(data, size);
+#endif
+}
+
+#endif //VIRTUAL_MEMORY_H
@@ -116,7 +116,7 @@ int main(int argc, char *argv[])
 
     // Temporary storage
     Arena frameArena;
-    init_arena(&frameArena, 64*1024*1024);
+    init_arena(&frameArena, 64*1024*1024, true);
 
     // Camera
     Camera camera;
@@ -142,6 +142,11 @@ int main(int argc, char *argv[])
     int width = 0;
     int height = 0;
 
+    // Stats of the previous frame
+    double frameMs = 0.0;
+    double frameMsMax = 0.0;
+    size_t frameArenaBytes = 0;
+
     while (!quit)
     {
         double frameStartTime = double(SDL_GetPerformanceCounter())/SDL_GetPerformanceFrequency();
@@ -184,6 +189,19 @@ int main(int argc, char *argv[])
         ImGui_ImplSDL2_NewFrame(window);
         ImGui::NewFrame();
 
+        // Stats
+        {
+            ImGui::Begin("Stats");
+            ImGui::Text("Frame %.2f ms, max %.2f ms", frameMs, frameMsMax);
+            ImGui::Text("Frame arena %zu / %zu kB", frameArenaBytes/1024, frameArena.capacity/1024);
+            ImGui::Text("Entities %d", entityGroup.entities.nOccupied);
+            if (ImGui::Button("Reset max"))
+            {
+                frameMsMax = 0.0;
+            }
+            ImGui::End();
+        }
+
         // Render
         {
             ImGui::Render();
@@ -213,12 +231,15 @@ int main(int argc, char *argv[])
             SDL_GL_SwapWindow(window);
         }
 
+        frameArenaBytes = frameArena.offsets.data[frameArena.offsets.size - 1];
         free_arena(&frameArena);
 
         // Limit FPS
         {
             double time = double(SDL_GetPerformanceCounter())/SDL_GetPerformanceFrequency();
             double msSinceFrameStart = 1000.0*(time - frameStartTime);
+            frameMs = msSinceFrameStart;
+            frameMsMax = max_i(frameMsMax, frameMs);
             double fpsLimit = 30.0;
             if (msSinceFrameStart < 1000.0/fpsLimit)
             {
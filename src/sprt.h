@@ -0,0 +1,163 @@
+#ifndef SPRT_H
+#define SPRT_H
+
+#include "stdint.h"
+#include "math.h"
+
+#include "SDL_assert.h"
+
+// Match statistics for A/B tests between two engine versions. Results are
+// added as games finish, the test can be stopped as soon as
+// sprt_decision() leaves SPRT_CONTINUE. Scores are from the view of the
+// new version: win 1, draw 0.5, loss 0.
+
+enum SprtDecision
+{
+    SPRT_CONTINUE,
+    SPRT_ACCEPT_H0,  // Not better than elo0, reject the patch
+    SPRT_ACCEPT_H1,  // At least elo1 better, accept the patch
+};
+
+struct SprtTest
+{
+    double elo0;
+    double elo1;
+    double lowerBound;
+    double upperBound;
+    int64_t nWins;
+    int64_t nDraws;
+    int64_t nLosses;
+    double llr;
+};
+
+static double elo_to_score(double elo)
+{
+    return 1.0/(1.0 + pow(10.0, -elo/400.0));
+}
+
+static double score_to_elo(double score)
+{
+    return -400.0*log10(1.0/score - 1.0);
+}
+
+// Mean score and its per-game variance of a trinomial W/D/L sample
+static void sprt_score_stats(int64_t nWins, int64_t nDraws, int64_t nLosses, double *score, double *variance)
+{
+    double n = double(nWins + nDraws + nLosses);
+    double w = double(nWins)/n;
+    double d = double(nDraws)/n;
+    *score = w + 0.5*d;
+    *variance = w + 0.25*d - (*score)*(*score);
+}
+
+// Log-likelihood ratio of H1 (elo1) against H0 (elo0), using the normal
+// approximation of the mean score (generalised SPRT)
+static double sprt_llr(int64_t nWins, int64_t nDraws, int64_t nLosses, double elo0, double elo1)
+{
+    int64_t n = nWins + nDraws + nLosses;
+    if (n == 0)
+    {
+        return 0.0;
+    }
+
+    double score, variance;
+    sprt_score_stats(nWins, nDraws, nLosses, &score, &variance);
+    if (variance <= 0.0)
+    {
+        // All games ended the same way, no spread to judge by yet
+        return 0.0;
+    }
+
+    double score0 = elo_to_score(elo0);
+    double score1 = elo_to_score(elo1);
+    double meanVariance = variance/double(n);
+    return (score1 - score0)*(2.0*score - score0 - score1)/(2.0*meanVariance);
+}
+
+// alpha: chance to accept H1 if H0 holds, beta: chance to accept H0 if H1 holds
+static void init_sprt_test(SprtTest *test, double elo0, double elo1, double alpha=0.05, double beta=0.05)
+{
+    SDL_assert(elo1 > elo0);
+    SDL_assert(alpha > 0.0 && alpha < 1.0 && beta > 0.0 && beta < 1.0);
+    test->elo0 = elo0;
+    test->elo1 = elo1;
+    test->lowerBound = log(beta/(1.0 - alpha));
+    test->upperBound = log((1.0 - beta)/alpha);
+    test->nWins = 0;
+    test->nDraws = 0;
+    test->nLosses = 0;
+    test->llr = 0.0;
+}
+
+static void sprt_add_results(SprtTest *test, int64_t nWins, int64_t nDraws, int64_t nLosses)
+{
+    test->nWins += nWins;
+    test->nDraws += nDraws;
+    test->nLosses += nLosses;
+    test->llr = sprt_llr(test->nWins, test->nDraws, test->nLosses, test->elo0, test->elo1);
+}
+
+// score: 1 win, 0.5 draw, 0 loss
+static void sprt_add_result(SprtTest *test, float score)
+{
+    sprt_add_results(test, score > 0.75f, score > 0.25f && score < 0.75f, score < 0.25f);
+}
+
+static SprtDecision sprt_decision(SprtTest *test)
+{
+    if (test->llr >= test->upperBound)
+    {
+        return SPRT_ACCEPT_H1;
+    }
+    if (test->llr <= test->lowerBound)
+    {
+        return SPRT_ACCEPT_H0;
+    }
+    return SPRT_CONTINUE;
+}
+
+// Two-sided normal quantile for a confidence level, e.g. 0.95 -> 1.96
+static double normal_quantile_two_sided(double confidence)
+{
+    // erf(z/sqrt(2)) = confidence, solved by bisection
+    double low = 0.0;
+    double high = 10.0;
+    for (int i=0; i<64; ++i)
+    {
+        double mid = 0.5*(low + high);
+        if (erf(mid/sqrt(2.0)) < confidence)
+        {
+            low = mid;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return 0.5*(low + high);
+}
+
+// Elo difference with the half width of its confidence interval. Scores of
+// exactly 0 or 1 are pulled in by half a game to keep the estimate finite.
+static double elo_estimate(int64_t nWins, int64_t nDraws, int64_t nLosses, double *errorMargin, double confidence=0.95)
+{
+    int64_t n = nWins + nDraws + nLosses;
+    if (n == 0)
+    {
+        *errorMargin = INFINITY;
+        return 0.0;
+    }
+
+    double score, variance;
+    sprt_score_stats(nWins, nDraws, nLosses, &score, &variance);
+    double limit = 0.5/double(n);
+    score = fmin(fmax(score, limit), 1.0 - limit);
+
+    double deviation = normal_quantile_two_sided(confidence)*sqrt(fmax(variance, 0.0)/double(n));
+    double low = fmax(score - deviation, limit);
+    double high = fmin(score + deviation, 1.0 - limit);
+    *errorMargin = 0.5*(score_to_elo(high) - score_to_elo(low));
+    return score_to_elo(score);
+}
+
+#endif //SPRT_H